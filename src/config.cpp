@@ -20,15 +20,23 @@
 #include "ui/durchblick.hpp"
 #include "ui/durchblick_dock.hpp"
 #include "util/util.h"
+#include <QCborValue>
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QSaveFile>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
 #include <obs-frontend-api.h>
 #include <obs-module.h>
 #include <util/platform.h>
+#include <mutex>
 #include <util/util.hpp>
 
 #if !defined(_WIN32) && !defined(__APPLE__)
@@ -39,36 +47,235 @@ namespace Config {
 Durchblick* db = nullptr;
 DurchblickDock* dbdock = nullptr;
 
-QJsonObject Cfg;
+// Each scene collection has its own file in the layouts folder,
+// index.json maps scene collection names to these files
+static QJsonObject Index;
+static bool IndexLoaded = false;
+static bool BinaryStorage = false; // Layout files are CBOR instead of JSON
+
+// Parsed layouts of the current scene collection, kept up to date by saves
+// so the dock, the tools menu and Load don't have to go to disk again
+static QString CachedCollection;
+static QJsonArray CachedLayouts;
+static bool CacheValid = false;
+
+// Saves are coalesced by this timer and written by a single background
+// thread, so writes happen in the order they were requested
+static QTimer* SaveTimer = nullptr;
+static QThreadPool* Writer = nullptr;
+// Hash of what's on disk per file. Updated by the writer and by Read() on the UI thread
+static QHash<QString, QByteArray> LastHashes;
+static std::mutex HashMutex;
+
+static QThreadPool* GetWriter()
+{
+    if (!Writer) {
+        Writer = new QThreadPool;
+        Writer->setMaxThreadCount(1);
+    }
+    return Writer;
+}
+
+static void WaitForWriter()
+{
+    if (Writer)
+        Writer->waitForDone();
+}
+
+static QString LayoutsFolder()
+{
+    BPtr<char> folder = obs_module_config_path("layouts");
+    return utf8_to_qt(folder.Get());
+}
+
+static QString IndexPath()
+{
+    return LayoutsFolder() + "/index.json";
+}
+
+static bool Write(QByteArray const& data, QString const& path)
+{
+    auto hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    {
+        std::lock_guard<std::mutex> lock(HashMutex);
+        if (LastHashes.value(path) == hash)
+            return true;
+    }
+
+    // QSaveFile writes to a temporary file and renames it over the
+    // config once everything was written, so a crash can't leave half a file
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        berr("Couldn't write config to %s", qt_to_utf8(path));
+        return false;
+    }
+
+    auto wrote = f.write(data);
+    if (data.length() != wrote) {
+        berr("Couldn't write config file to %s, only"
+             "wrote %lli bytes out of %i",
+            qt_to_utf8(path), wrote, int(data.length()));
+        f.cancelWriting();
+        return false;
+    }
+
+    if (!f.commit()) {
+        berr("Couldn't replace config file %s", qt_to_utf8(path));
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(HashMutex);
+    LastHashes[path] = hash;
+    return true;
+}
+
+static QByteArray Read(QString const& path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return {};
+    auto data = f.readAll();
+    auto hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    std::lock_guard<std::mutex> lock(HashMutex);
+    LastHashes[path] = hash;
+    return data;
+}
+
+static QByteArray IndexDocument()
+{
+    QJsonObject obj;
+    obj["format"] = BinaryStorage ? "cbor" : "json";
+    obj["collections"] = Index;
+    return QJsonDocument(obj).toJson();
+}
+
+static QString Extension(bool binary)
+{
+    return binary ? ".cbor" : ".json";
+}
+
+// CBOR converts losslessly from and to JSON values, so both formats hold the same data
+static QByteArray EncodeLayouts(QJsonArray const& layouts, bool binary)
+{
+    if (binary)
+        return QCborValue::fromJsonValue(layouts).toCbor();
+    return QJsonDocument(layouts).toJson();
+}
+
+static QJsonArray DecodeLayouts(QByteArray const& data, bool binary)
+{
+    if (binary)
+        return QCborValue::fromCbor(data).toJsonValue().toArray();
+    return QJsonDocument::fromJson(data).array();
+}
+
+/// Returns the path of the layout file for this scene collection without
+/// extension, a new file is added to the index if there is none yet
+static QString LayoutPath(QString const& collection)
+{
+    auto file = Index.value(collection).toString();
+    if (file.isEmpty()) {
+        QString base;
+        for (auto const& c : collection)
+            base += c.isLetterOrNumber() || c == '-' || c == '_' ? c : QChar('_');
+        if (base.isEmpty())
+            base = "collection";
+
+        QStringList used;
+        for (auto const& v : std::as_const(Index))
+            used.append(v.toString());
+        file = base;
+        for (int i = 2; used.contains(file, Qt::CaseInsensitive); i++)
+            file = QString("%1_%2").arg(base).arg(i);
+        Index[collection] = file;
+    }
+    return LayoutsFolder() + "/" + file;
+}
+
+// Splits the old layout.json, which contained every scene collection, into one file per collection
+static void MigrateLegacyConfig()
+{
+    BPtr<char> legacy_path = obs_module_config_path("layout.json");
+    auto legacy = utf8_to_qt(legacy_path.Get());
+    if (!QFile::exists(legacy))
+        return;
+
+    auto cfg = QJsonDocument::fromJson(Read(legacy)).object();
+    for (auto it = cfg.begin(); it != cfg.end(); ++it) {
+        auto data = EncodeLayouts(it.value().toArray(), BinaryStorage);
+        if (!Write(data, LayoutPath(it.key()) + Extension(BinaryStorage)))
+            return;
+    }
+
+    if (!Write(IndexDocument(), IndexPath()))
+        return;
+
+    QFile::remove(legacy + ".bak");
+    QFile::rename(legacy, legacy + ".bak");
+    binfo("Moved layouts of %i scene collection(s) from layout.json into %s", int(cfg.size()), qt_to_utf8(LayoutsFolder()));
+}
+
+static void LoadIndex()
+{
+    if (IndexLoaded)
+        return;
+    IndexLoaded = true;
+
+    if (os_mkdirs(qt_to_utf8(LayoutsFolder())) == MKDIR_ERROR)
+        berr("Failed to create layout folder '%s'", qt_to_utf8(LayoutsFolder()));
+
+    if (!QFile::exists(IndexPath()))
+        MigrateLegacyConfig();
+    else {
+        auto index = QJsonDocument::fromJson(Read(IndexPath())).object();
+        Index = index["collections"].toObject();
+        BinaryStorage = index["format"].toString() == "cbor";
+    }
+}
+
+// Only the file of this collection is decoded. Files that haven't been
+// saved since the storage format was changed are still in the other format
+static QJsonArray ReadLayouts(QString const& collection)
+{
+    auto path = LayoutPath(collection);
+    for (bool binary : { BinaryStorage, !BinaryStorage }) {
+        auto file = path + Extension(binary);
+        if (QFile::exists(file))
+            return DecodeLayouts(Read(file), binary);
+    }
+    return {};
+}
 
 QJsonArray LoadLayoutsForCurrentSceneCollection()
 {
-    BPtr<char> path = obs_module_config_path("layout.json");
     BPtr<char> sc = obs_frontend_get_current_scene_collection();
-    BPtr<char> folder = obs_module_config_path("");
+    auto folder = LayoutsFolder();
 
-    if (os_mkdirs(folder) == MKDIR_ERROR) {
-        berr("Failed to change directory from '%s'. Cannot save/load layouts.", folder.Get());
+    if (os_mkdirs(qt_to_utf8(folder)) == MKDIR_ERROR) {
+        berr("Failed to change directory from '%s'. Cannot save/load layouts.", qt_to_utf8(folder));
         return {};
     }
 
-    QFile f(utf8_to_qt(path.Get()));
-
-    if (f.exists()) {
-        if (f.open(QIODevice::ReadOnly)) {
-            QJsonDocument doc;
-            doc = QJsonDocument::fromJson(f.readAll());
-            f.close();
-            Cfg = doc.object();
-            auto layouts = Cfg[utf8_to_qt(sc.Get())].toArray();
-            if (layouts.isEmpty()) {
-                berr("No layouts found");
-                return {};
-            }
-            return layouts;
-        }
+    LoadIndex();
+
+    auto collection = utf8_to_qt(sc.Get());
+    if (CacheValid && CachedCollection == collection)
+        return CachedLayouts;
+
+    // Don't read a file that's about to be replaced
+    WaitForWriter();
+
+    QJsonArray layouts;
+    if (Index.contains(collection))
+        layouts = ReadLayouts(collection);
+    CachedCollection = collection;
+    CachedLayouts = layouts;
+    CacheValid = true;
+
+    if (layouts.isEmpty()) {
+        berr("No layouts found");
+        return {};
     }
-    return {};
+    return layouts;
 }
 
 void RegisterCallbacks()
@@ -88,10 +295,10 @@ void RegisterCallbacks()
             // I couldn't find another event that was on exit and
             // before source/scene data was cleared
 
-            Save();
+            Flush();
             Cleanup();
         } else if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING) {
-            Save(); // Save current layout
+            SaveNow(); // Save current layout
             db->GetLayout()->Clear();
         } else if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED) {
             Load();
@@ -135,14 +342,11 @@ void Load()
     }
 }
 
-void Save()
+// Serializes the layouts of the current scene collection, has to run on the UI thread
+static QJsonArray Snapshot()
 {
-
     QJsonArray layouts {};
     QJsonObject obj1 {}, obj2 {};
-    BPtr<char> path = obs_module_config_path("layout.json");
-    BPtr<char> sc = obs_frontend_get_current_scene_collection();
-    QFile f(utf8_to_qt(path.Get()));
 
     if (db) {
         db->Save(obj1);
@@ -157,27 +361,103 @@ void Save()
     } else {
         layouts.append({});
     }
+    return layouts;
+}
 
-    Cfg[utf8_to_qt(sc.Get())] = layouts;
-    if (f.open(QIODevice::WriteOnly)) {
-        QJsonDocument doc;
-        doc.setObject(Cfg);
-        auto data = doc.toJson();
-        auto wrote = f.write(data);
+// Everything the writer needs, collected on the UI thread
+struct SaveJob {
+    QJsonArray layouts;
+    QString path; // Without extension
+    QByteArray index;
+    bool binary;
 
-        if (data.length() != wrote) {
-            berr("Couldn't write config file to %s, only"
-                 "wrote %lli bytes out of %i",
-                path.Get(), wrote, int(data.length()));
+    void Run() const
+    {
+        Write(index, IndexPath()); // Skipped by the hash check if nothing changed
+        if (!Write(EncodeLayouts(layouts, binary), path + Extension(binary)))
+            return;
+
+        // Drop the copy in the other format, if the storage format was changed
+        auto old = path + Extension(!binary);
+        if (QFile::exists(old)) {
+            QFile::remove(old);
+            std::lock_guard<std::mutex> lock(HashMutex);
+            LastHashes.remove(old);
         }
-        f.close();
-    } else {
-        berr("Couldn't write config to %s", path.Get());
     }
+};
+
+static SaveJob MakeSaveJob()
+{
+    BPtr<char> sc = obs_frontend_get_current_scene_collection();
+    LoadIndex();
+
+    SaveJob job;
+    job.layouts = Snapshot();
+    job.path = LayoutPath(utf8_to_qt(sc.Get()));
+    job.binary = BinaryStorage;
+    job.index = IndexDocument();
+
+    CachedCollection = utf8_to_qt(sc.Get());
+    CachedLayouts = job.layouts;
+    CacheValid = true;
+    return job;
+}
+
+bool GetBinaryStorage()
+{
+    LoadIndex();
+    return BinaryStorage;
+}
+
+void SetBinaryStorage(bool binary)
+{
+    LoadIndex();
+    if (binary == BinaryStorage)
+        return;
+    BinaryStorage = binary;
+    SaveNow();
+}
+
+void Save()
+{
+    if (!SaveTimer) {
+        SaveTimer = new QTimer;
+        SaveTimer->setSingleShot(true);
+        SaveTimer->setInterval(500);
+        QObject::connect(SaveTimer, &QTimer::timeout, SaveNow);
+    }
+    SaveTimer->start();
+}
+
+void SaveNow()
+{
+    if (SaveTimer)
+        SaveTimer->stop();
+
+    // Only the snapshot has to happen here, serializing and writing
+    // is done on the writer thread
+    GetWriter()->start([job = MakeSaveJob()] {
+        job.Run();
+    });
+}
+
+void Flush()
+{
+    if (SaveTimer)
+        SaveTimer->stop();
+    auto job = MakeSaveJob();
+    WaitForWriter();
+    job.Run();
 }
 
 void Cleanup()
 {
+    WaitForWriter();
+    delete SaveTimer;
+    SaveTimer = nullptr;
+    delete Writer;
+    Writer = nullptr;
     if (db) {
         db->deleteLater();
         db = nullptr;
@@ -32,7 +32,18 @@ extern void RegisterCallbacks();
 
 extern void Load();
 
+/// Saves the layouts after a short delay, repeated calls are coalesced
 extern void Save();
 
+/// Takes a snapshot of the layouts right away and writes it in the background
+extern void SaveNow();
+
+/// Takes a snapshot and writes it before returning
+extern void Flush();
+
 extern void Cleanup();
+
+/// Whether layouts are stored as CBOR instead of JSON, applies to all scene collections
+extern bool GetBinaryStorage();
+extern void SetBinaryStorage(bool binary);
 }
@@ -37,13 +37,16 @@ bool obs_module_load()
 
     QAction::connect(static_cast<QAction*>(obs_frontend_add_tools_menu_qaction(T_MENU_OPTION)),
         &QAction::triggered, [] {
-            auto layouts = Config::LoadLayoutsForCurrentSceneCollection();
-
             Config::db->CreateDisplay(true);
-            if (layouts.size() > 0)
-                Config::db->Load(layouts[0].toObject());
-            else
-                Config::db->GetLayout()->CreateDefaultLayout();
+
+            // Closing the window deletes its layout, otherwise it's still loaded
+            if (Config::db->GetLayout()->IsEmpty()) {
+                auto layouts = Config::LoadLayoutsForCurrentSceneCollection();
+                if (layouts.size() > 0)
+                    Config::db->Load(layouts[0].toObject());
+                else
+                    Config::db->GetLayout()->CreateDefaultLayout();
+            }
             Config::db->show();
         });
 
@@ -29,26 +29,36 @@ void AudioMixerItem::LoadConfigFromWidget(QWidget* w)
     m_mixer->SetChannelWidth(cfg->m_channel_width->value());
 }
 
-void AudioMixerItem::Render(const DurchblickItemConfig& cfg)
+void AudioMixerItem::Render(const DurchblickItemConfig& cfg, RenderData const& rd)
 {
-    LayoutItem::Render(cfg);
+    LayoutItem::Render(cfg, rd);
     m_mixer->Render(cfg.scale, 1, 1);
 }
 
 void AudioMixerItem::WriteToJson(QJsonObject& Obj)
 {
     LayoutItem::WriteToJson(Obj);
+    Obj["compact"] = m_toggle_compact->isChecked();
 }
 
 void AudioMixerItem::ReadFromJson(const QJsonObject& Obj)
 {
     LayoutItem::ReadFromJson(Obj);
+    m_toggle_compact->setChecked(Obj["compact"].toBool());
 }
 
-void AudioMixerItem::Update(const DurchblickItemConfig& cfg)
+void AudioMixerItem::ContextMenu(QMenu& m)
 {
-    LayoutItem::Update(cfg);
-    m_mixer->Update(cfg);
+    // Stretching doesn't apply to the mixer, so no base class actions
+    m.addAction(m_toggle_compact);
+}
+
+void AudioMixerItem::Update(const DurchblickItemConfig& cfg, int dirty)
+{
+    LayoutItem::Update(cfg, dirty);
+    // Slider layout only depends on the item size
+    if (dirty & DIRTY_CELLS)
+        m_mixer->Update(cfg);
 }
 
 void AudioMixerItem::MouseEvent(const MouseData& e, const DurchblickItemConfig& cfg)
@@ -56,3 +66,9 @@ void AudioMixerItem::MouseEvent(const MouseData& e, const DurchblickItemConfig&
     LayoutItem::MouseEvent(e, cfg);
     m_mixer->MouseEvent(e, cfg);
 }
+
+void AudioMixerItem::MouseLeave()
+{
+    LayoutItem::MouseLeave();
+    m_mixer->MouseLeave();
+}
@@ -52,24 +52,32 @@ class AudioMixerItem : public LayoutItem {
     Q_OBJECT
     bool m_program { false };
     std::unique_ptr<AudioMixerRenderer> m_mixer {};
+    QAction* m_toggle_compact;
+
+protected:
+    void Release() override { m_mixer->Release(); }
 
 public:
     AudioMixerItem(Layout* parent, int x, int y, int w = 1, int h = 1)
         : LayoutItem(parent, x, y, w, h)
     {
         m_mixer = std::make_unique<AudioMixerRenderer>(this);
+        m_toggle_compact = new QAction(T_AUDIO_MIXER_COMPACT, this);
+        m_toggle_compact->setCheckable(true);
+        connect(m_toggle_compact, &QAction::toggled, this, [this](bool checked) { m_mixer->SetCompact(checked); });
     }
 
     ~AudioMixerItem() = default;
     QWidget* GetConfigWidget() override;
     void LoadConfigFromWidget(QWidget*) override;
-    void Render(DurchblickItemConfig const& cfg) override;
+    void Render(DurchblickItemConfig const& cfg, RenderData const& rd) override;
 
     void WriteToJson(QJsonObject& Obj) override;
     void ReadFromJson(QJsonObject const& Obj) override;
 
-    void ContextMenu(QMenu&) override { }
-    virtual void Update(DurchblickItemConfig const& cfg) override;
+    void ContextMenu(QMenu&) override;
+    virtual void Update(DurchblickItemConfig const& cfg, int dirty = DIRTY_ALL) override;
 
     void MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg) override;
+    void MouseLeave() override;
 };
@@ -17,8 +17,8 @@
  *************************************************************************/
 
 #include "custom_item.hpp"
+#include "../util/json_bridge.hpp"
 #include <QJsonArray>
-#include <QJsonDocument>
 
 CustomItem::CustomItem(Layout* parent, DurchblickCallbacks const& cb, int x, int y, int w, int h)
     : LayoutItem(parent, x, y, w, h)
@@ -32,10 +32,10 @@ CustomItem::~CustomItem()
     m_cb_data.Destroy(this, PrivateData);
 }
 
-void CustomItem::Update(DurchblickItemConfig const& cfg)
+void CustomItem::Update(DurchblickItemConfig const& cfg, int dirty)
 {
-    LayoutItem::Update(cfg);
-    if (m_cb_data.Update)
+    LayoutItem::Update(cfg, dirty);
+    if (m_cb_data.Update && (dirty & DIRTY_CELLS))
         m_cb_data.Update(this, PrivateData, &cfg, m_cell.col, m_cell.row, m_cell.w, m_cell.h);
 }
 
@@ -53,9 +53,9 @@ void CustomItem::MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
         m_cb_data.MouseEvent(this, PrivateData, &cfg, e.x, e.y, e.buttons, e.modifiers);
 }
 
-void CustomItem::Render(DurchblickItemConfig const& cfg)
+void CustomItem::Render(DurchblickItemConfig const& cfg, RenderData const& rd)
 {
-    LayoutItem::Render(cfg);
+    LayoutItem::Render(cfg, rd);
     m_cb_data.Render(this, PrivateData, &cfg);
 }
 
@@ -66,23 +66,15 @@ void CustomItem::WriteToJson(QJsonObject& Obj)
 
     if (m_cb_data.Save) {
         auto* json = m_cb_data.Save(this, PrivateData);
-        // I assume iterating the objects would be faster than encoding and then decoding again
-        // but I'm lazy.
-        auto* c = json_dumps(json, JSON_COMPACT);
-        QJsonParseError err;
-        QJsonDocument tmp = QJsonDocument::fromJson(c, &err);
+        auto data = JsonBridge::ToQt(json);
 
-        if (err.error == QJsonParseError::NoError && !tmp.isNull()) {
-            if (tmp.isObject())
-                Obj["custom_data"] = tmp.object();
-            else
-                Obj["custom_data"] = tmp.array();
+        if (data.isObject() || data.isArray()) {
+            Obj["custom_data"] = data;
         } else {
-            berr("Failed to write custom widget data for '%s' error: %s",
-                m_cb_data.GetId(), qt_to_utf8(err.errorString()));
+            berr("Failed to write custom widget data for '%s': Save didn't return an object or array",
+                m_cb_data.GetId());
         }
 
-        free(c);
         json_decref(json);
     }
 }
@@ -92,31 +84,17 @@ void CustomItem::ReadFromJson(const QJsonObject& Obj)
     LayoutItem::ReadFromJson(Obj);
     if (m_cb_data.Load && Obj.contains("custom_data")) {
         auto data = Obj["custom_data"];
-        QJsonDocument tmp;
-        if (data.isObject())
-            tmp.setObject(data.toObject());
-        else if (data.isArray())
-            tmp.setArray(data.toArray());
-
-        if (!tmp.isNull()) {
-            auto string = tmp.toJson(QJsonDocument::Compact);
-            json_error_t err;
-            auto* json = json_loads(string, 0, &err);
-
-            if (json) {
-                m_cb_data.Load(this, PrivateData, json);
-                json_decref(json);
-            } else {
-                berr("Failed to load custom widget data for '%s' error (line %i, col %i): %s",
-                    m_cb_data.GetId(), err.line, err.column, err.text);
-            }
+        if (data.isObject() || data.isArray()) {
+            auto* json = JsonBridge::ToJansson(data);
+            m_cb_data.Load(this, PrivateData, json);
+            json_decref(json);
         }
     }
 }
 
-uint32_t CustomItem::GetFillColor()
+uint32_t CustomItem::GetFillColor(RenderData const& rd)
 {
     if (m_cb_data.GetFillColor)
         return m_cb_data.GetFillColor(this, PrivateData);
-    return LayoutItem::GetFillColor();
+    return LayoutItem::GetFillColor(rd);
 }
@@ -31,11 +31,11 @@ public:
     CustomItem(Layout* parent, DurchblickCallbacks const& cbs, int x, int y, int w = 1, int h = 1);
     ~CustomItem();
 
-    void Update(DurchblickItemConfig const& cfg) override;
+    void Update(DurchblickItemConfig const& cfg, int dirty = DIRTY_ALL) override;
     void ContextMenu(QMenu&) override;
     void MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg) override;
-    void Render(DurchblickItemConfig const& cfg) override;
+    void Render(DurchblickItemConfig const& cfg, RenderData const& rd) override;
     void WriteToJson(QJsonObject& Obj) override;
     void ReadFromJson(QJsonObject const& Obj) override;
-    uint32_t GetFillColor() override;
+    uint32_t GetFillColor(RenderData const& rd) override;
 };
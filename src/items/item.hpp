@@ -18,12 +18,15 @@
 
 #pragma once
 #include "../util/callbacks.h"
+#include "../util/draw_list.hpp"
 #include "../util/util.h"
 #include <QContextMenuEvent>
 #include <QJsonObject>
 #include <QMenu>
 #include <QObject>
+#include <atomic>
 #include <obs-module.h>
+#include <obs.hpp>
 
 class Layout;
 
@@ -31,12 +34,26 @@ class Layout;
 class LayoutItem : public QObject {
     Q_OBJECT
 protected:
-    bool m_mouse_over { false };
+    std::atomic<bool> m_mouse_over {}; // Also read by the render scheduler
     Layout* m_layout {};
     QAction* m_toggle_stretch;
+    std::atomic<bool> m_stretch {}; // Mirrors m_toggle_stretch for the graphics thread
 
     int m_mouse_x {}, m_mouse_y {};
 
+    // Labels, volmeters etc. are only created once the item is actually drawn
+    // and are dropped again when its display stays hidden for a while
+    std::atomic<bool> m_materialized {}, m_materialize_queued {};
+
+    // Set by the layout before every Render(), tells items that can draw a
+    // cached frame whether they may refresh it. Graphics thread only
+    int m_render_mode {};
+
+    /// Creates heavyweight resources, called on the UI thread after the first frame
+    virtual void Materialize() { }
+    /// Frees whatever Materialize() created, called on the UI thread while nothing is rendered
+    virtual void Release() { }
+
 public:
     struct Cell {
     private:
@@ -101,6 +118,7 @@ public:
         m_cell = { x, y, w, h };
         m_toggle_stretch = new QAction(T_WIDGET_STRETCH, this);
         m_toggle_stretch->setCheckable(true);
+        connect(m_toggle_stretch, &QAction::toggled, this, [this](bool checked) { m_stretch = checked; });
     }
 
     virtual ~LayoutItem()
@@ -126,8 +144,70 @@ public:
         m_toggle_stretch->setChecked(Obj["stretch"].toBool());
     }
 
+    /// Frontend state that is looked up once per frame by the layout, before any item is drawn
+    struct FrameData {
+        OBSSource program, preview;
+        bool studio_mode {};
+    };
+
+    /// The part of the layout snapshot an item is drawn from, so the graphics
+    /// thread never reads fields that the UI thread changes
+    struct RenderData {
+        OBSSource source;
+        int inner_width {}, inner_height {};
+        FrameData const* frame {}; // Owned by the layout, always set
+    };
+
+    /// Source the snapshot keeps for Render(), UI thread only
+    virtual obs_source_t* RenderSource() { return nullptr; }
+
+    /// Lower classes are refreshed first when a layout is over its render time budget
+    enum Priority {
+        PRIORITY_PROGRAM,
+        PRIORITY_PREVIEW,
+        PRIORITY_HOVERED, // Assigned by the layout, always refreshed like the ones above
+        PRIORITY_LIVE,    // Scenes on program or preview
+        PRIORITY_STATIC,
+        PRIORITY_CUSTOM,
+    };
+
+    enum RenderMode {
+        RENDER_FULL,    // Render as usual
+        RENDER_CACHED,  // Draw the last cached frame if there is one
+        RENDER_REFRESH, // Render and update the cache
+    };
+
+    uint64_t m_render_cost_ns {}; // Smoothed CPU time of a full render, graphics thread only
+
+    virtual Priority RenderPriority(RenderData const&) { return PRIORITY_CUSTOM; }
+    /// Whether RENDER_CACHED makes this item cheaper to draw
+    virtual bool CanRenderCached() const { return false; }
+    void SetRenderMode(RenderMode mode) { m_render_mode = mode; }
+
+    /// Called by the layout on the graphics thread before the item is drawn
+    void EnsureMaterialized()
+    {
+        if (m_materialized || m_materialize_queued.exchange(true))
+            return;
+        QMetaObject::invokeMethod(
+            this, [this] {
+                m_materialize_queued = false;
+                if (!m_materialized.exchange(true))
+                    Materialize();
+            },
+            Qt::QueuedConnection);
+    }
+
+    void ReleaseResources()
+    {
+        if (m_materialized.exchange(false))
+            Release();
+    }
+
+    bool IsMaterialized() const { return m_materialized; }
+
     /// Determines the border of the cell when it is not hovered
-    virtual uint32_t GetFillColor() { return COLOR_BORDER_GRAY; }
+    virtual uint32_t GetFillColor(RenderData const&) { return COLOR_BORDER_GRAY; }
 
     virtual QWidget* GetConfigWidget() { return nullptr; }
     virtual void LoadConfigFromWidget(QWidget*) { }
@@ -137,9 +217,9 @@ public:
         m.addAction(m_toggle_stretch);
     }
 
-    virtual void Render(DurchblickItemConfig const&)
+    virtual void Render(DurchblickItemConfig const&, RenderData const&)
     {
-        DrawBox(0, 0, m_inner_width, m_inner_height, COLOR_BLACK);
+        // The black background is drawn by the layout together with the cell borders
     }
 
     virtual void MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
@@ -151,9 +231,17 @@ public:
             int y = e.y / cfg.cell_height;
             m_hovered_cell.col = x;
             m_hovered_cell.row = y;
-            m_mouse_x = ((e.x - m_rel_left - cfg.border) / (cfg.cell_width * m_cell.w - cfg.border2)) * m_inner_width;
-            m_mouse_y = ((e.y - m_rel_top - cfg.border) / (cfg.cell_height * m_cell.h - cfg.border2)) * m_inner_height;
         }
+        // Events only arrive while this item is hovered or has captured the mouse,
+        // in the latter case the position can be outside of the item
+        m_mouse_x = ((e.x - m_rel_left - cfg.border) / (cfg.cell_width * m_cell.w - cfg.border2)) * m_inner_width;
+        m_mouse_y = ((e.y - m_rel_top - cfg.border) / (cfg.cell_height * m_cell.h - cfg.border2)) * m_inner_height;
+    }
+
+    /// Called by the layout when the mouse moved onto another item
+    virtual void MouseLeave()
+    {
+        m_mouse_over = false;
     }
 
     bool IsMouseOver(int x, int y)
@@ -174,20 +262,47 @@ public:
     uint32_t MouseX() const { return m_mouse_x; }
     uint32_t MouseY() const { return m_mouse_y; }
 
-    virtual void Update(DurchblickItemConfig const& cfg)
+    /// Which parts of the layout config changed since the last update
+    enum DirtyFlags {
+        DIRTY_NONE = 0,
+        DIRTY_ORIGIN = 1 << 0, // Position of the multiview inside the window
+        DIRTY_SCALE = 1 << 1,  // Scale between multiview and window
+        DIRTY_CELLS = 1 << 2,  // Cell size, border or canvas size
+        DIRTY_ALL = DIRTY_ORIGIN | DIRTY_SCALE | DIRTY_CELLS,
+    };
+
+    static int GetDirtyFlags(DurchblickItemConfig const& a, DurchblickItemConfig const& b)
     {
-        m_rel_left = cfg.cell_width * m_cell.col;
-        m_left = cfg.x + m_rel_left;
-        m_rel_right = cfg.cell_width * (m_cell.col + m_cell.w);
-        m_right = cfg.x + m_rel_right;
-        m_rel_top = cfg.cell_height * m_cell.row;
-        m_top = cfg.y + m_rel_top;
-        m_rel_bottom = cfg.cell_height * (m_cell.row + m_cell.h);
-        m_bottom = cfg.y + m_rel_bottom;
-        m_width = cfg.cell_width * m_cell.w;
-        m_height = cfg.cell_height * m_cell.h;
-        m_inner_width = m_width - cfg.border2;
-        m_inner_height = m_height - cfg.border2;
+        int dirty = DIRTY_NONE;
+        if (a.x != b.x || a.y != b.y)
+            dirty |= DIRTY_ORIGIN;
+        if (a.scale != b.scale)
+            dirty |= DIRTY_SCALE;
+        if (a.cx != b.cx || a.cy != b.cy || a.canvas_width != b.canvas_width || a.canvas_height != b.canvas_height
+            || a.cell_width != b.cell_width || a.cell_height != b.cell_height || a.border != b.border || a.border2 != b.border2)
+            dirty |= DIRTY_CELLS;
+        return dirty;
+    }
+
+    virtual void Update(DurchblickItemConfig const& cfg, int dirty = DIRTY_ALL)
+    {
+        if (dirty & DIRTY_CELLS) {
+            m_rel_left = cfg.cell_width * m_cell.col;
+            m_rel_right = cfg.cell_width * (m_cell.col + m_cell.w);
+            m_rel_top = cfg.cell_height * m_cell.row;
+            m_rel_bottom = cfg.cell_height * (m_cell.row + m_cell.h);
+            m_width = cfg.cell_width * m_cell.w;
+            m_height = cfg.cell_height * m_cell.h;
+            m_inner_width = m_width - cfg.border2;
+            m_inner_height = m_height - cfg.border2;
+        }
+
+        if (dirty & (DIRTY_CELLS | DIRTY_ORIGIN)) {
+            m_left = cfg.x + m_rel_left;
+            m_right = cfg.x + m_rel_right;
+            m_top = cfg.y + m_rel_top;
+            m_bottom = cfg.y + m_rel_bottom;
+        }
     }
 
     static void DrawBox(float cx, float cy, uint32_t colorVal)
@@ -208,6 +323,16 @@ public:
         DrawBox(cx, cy, color);
         gs_matrix_pop();
     };
+
+    /// Like DrawBox, but batched with other boxes of the same layer if the layout is rendering
+    static void QueueBox(float tx, float ty, float cx, float cy, uint32_t color,
+        DrawList::Layer layer = DrawList::LAYER_CONTENT)
+    {
+        if (auto* dl = DrawList::Current())
+            dl->AddQuad(tx, ty, cx, cy, color, layer);
+        else
+            DrawBox(tx, ty, cx, cy, color);
+    }
 };
 
 class PlaceholderItem : public LayoutItem {
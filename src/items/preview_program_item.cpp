@@ -18,6 +18,7 @@
 
 #include "preview_program_item.hpp"
 #include "../layout.hpp"
+#include "../util/source_cache.hpp"
 #include <QApplication>
 #include <obs-frontend-api.h>
 
@@ -39,8 +40,17 @@ void PreviewProgramItem::LoadConfigFromWidget(QWidget* w)
     CreateLabel();
 }
 
+void PreviewProgramItem::UpdateLabel()
+{
+    if (m_toggle_label->isChecked())
+        CreateLabel();
+}
+
 void PreviewProgramItem::CreateLabel()
 {
+    if (!m_materialized)
+        return;
+
     struct obs_video_info ovi;
     obs_get_video_info(&ovi);
     uint32_t h = ovi.base_height;
@@ -49,50 +59,51 @@ void PreviewProgramItem::CreateLabel()
         name = T_PROGRAM;
     else
         name = T_PREVIEW;
-    m_label = ::CreateLabel(qt_to_utf8(name), h / 1.5, m_font_scale);
+    std::atomic_store(&m_label, ::CreateLabel(qt_to_utf8(name), h / 1.5, m_font_scale));
 }
 
 static const uint32_t labelColor = 0xD91F1F1F;
 
-void PreviewProgramItem::Render(DurchblickItemConfig const& cfg)
+void PreviewProgramItem::Render(DurchblickItemConfig const& cfg, RenderData const& rd)
 {
-    LayoutItem::Render(cfg); // Skip SourceItem
+    LayoutItem::Render(cfg, rd); // Skip SourceItem
 
-    if (!m_src)
+    if (!rd.source)
         return;
     auto w = cfg.canvas_width;
     auto h = cfg.canvas_height;
-    if (m_toggle_stretch->isChecked()) {
-        gs_matrix_scale3f(m_inner_width / float(w), m_inner_height / float(h), 1);
+    float scale_x, scale_y;
+    if (m_stretch) {
+        scale_x = rd.inner_width / float(w);
+        scale_y = rd.inner_height / float(h);
     } else {
         int x, y;
-        float scale;
-        GetScaleAndCenterPos(w, h, m_inner_width, m_inner_height, x, y, scale);
+        GetScaleAndCenterPos(w, h, rd.inner_width, rd.inner_height, x, y, scale_x);
+        scale_y = scale_x;
         gs_matrix_translate3f(x, y, 0);
-        gs_matrix_scale3f(scale, scale, 1);
     }
+    gs_matrix_scale3f(scale_x, scale_y, 1);
 
-    if (m_program || !obs_frontend_preview_program_mode_active()) {
+    if (m_program || !rd.frame->studio_mode) {
         obs_render_main_texture();
-    } else {
-        OBSSourceAutoRelease src = obs_frontend_get_current_preview_scene();
-        obs_source_video_render(src);
+    } else if (obs_source_t* src = rd.frame->preview) {
+        SourceCache::Render(src, uint32_t(w * scale_x * cfg.scale + 0.5f), uint32_t(h * scale_y * cfg.scale + 0.5f));
     }
 
-    if (m_toggle_label->isChecked() && m_label) {
-        auto lw = obs_source_get_width(m_label);
-        auto lh = obs_source_get_height(m_label);
+    auto label = std::atomic_load(&m_label);
+    if (m_show_label && label && label->Ready()) {
+        auto lw = label->Width();
+        auto lh = label->Height();
 
         if (lw >= 30 && lh >= 10) { // No reason to draw an unreadable label
             gs_matrix_push();
             gs_matrix_translate3f((cfg.canvas_width - lw) / 2, cfg.canvas_height - lh * 1.5, 0.0f);
-            DrawBox(lw, lh, labelColor);
-            gs_matrix_translate3f(0, -(lh * 0.08), 0.0f);
-            obs_source_video_render(m_label);
+            QueueBox(0, 0, lw, lh, labelColor, DrawList::LAYER_LABEL);
+            label->Draw();
             gs_matrix_pop();
         }
     }
-    if (m_toggle_safe_borders->isChecked())
+    if (m_show_safe_borders)
         RenderSafeMargins(w, h);
 }
 
@@ -72,9 +72,13 @@ public:
     QWidget* GetConfigWidget() override;
     void LoadConfigFromWidget(QWidget*) override;
     void CreateLabel();
-    void Render(DurchblickItemConfig const& cfg) override;
+    void UpdateLabel() override;
+    void Render(DurchblickItemConfig const& cfg, RenderData const& rd) override;
 
     void WriteToJson(QJsonObject& Obj) override;
     void ReadFromJson(QJsonObject const& Obj) override;
     bool EnableVolumeMeter() const override { return false; }
+    bool EnableRefreshRate() const override { return false; } // Preview and program always run at full rate
+    bool CanRenderCached() const override { return false; }
+    Priority RenderPriority(RenderData const&) override { return m_program ? PRIORITY_PROGRAM : PRIORITY_PREVIEW; }
 };
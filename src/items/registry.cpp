@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #include "registry.hpp"
+#include "../util/source_cache.hpp"
 #include "../util/util.h"
 #include "audio_mixer.hpp"
 #include "custom_item.hpp"
@@ -99,6 +100,10 @@ void RegisterDefaults()
     Registry::Register<SceneItem>(T_WIDGET_SCENE);
 
     Registry::AddCallbacks<SourceItem>();
+    Registry::AddCallbacks<MixerMeter>();
+    Registry::AddCallbacks<SourceCache>();
+    Labels::Init();
+    ItemRegistry::DeinitCallbacks.append(Labels::Deinit);
 }
 
 LayoutItem* MakeItem(Layout* l, QJsonObject const& obj)
@@ -44,6 +44,7 @@ void SceneItem::LoadConfigFromWidget(QWidget* w)
     if (custom) {
         OBSSceneAutoRelease s = obs_get_scene_by_name(qt_to_utf8(custom->m_combo_box->currentText()));
         m_font_scale = custom->m_font_size->value() / 100.f;
+        SetMaxFps(custom->m_refresh_rate->currentData().toInt());
         SetSource(obs_scene_get_source(s));
         if (custom->m_border->isChecked())
             m_indicator_type = Indicator::BORDER;
@@ -57,13 +58,13 @@ void SceneItem::LoadConfigFromWidget(QWidget* w)
 void SceneItem::MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
 {
     SourceItem::MouseEvent(e, cfg);
-    auto transitionOnDoubleClick = config_get_bool(
-        obs_frontend_get_app_config(), "BasicWindow", "TransitionOnDoubleClick");
-    auto switchOnClick = config_get_bool(obs_frontend_get_app_config(), "BasicWindow",
-        "MultiviewMouseSwitch");
     if (Hovered()) {
         auto islmb = e.buttons & Qt::LeftButton;
         if (e.double_click && islmb) {
+            auto transitionOnDoubleClick = config_get_bool(
+                obs_frontend_get_app_config(), "BasicWindow", "TransitionOnDoubleClick");
+            auto switchOnClick = config_get_bool(obs_frontend_get_app_config(), "BasicWindow",
+                "MultiviewMouseSwitch");
             if (!(obs_frontend_preview_program_mode_active() && transitionOnDoubleClick && switchOnClick))
                 return;
             OBSSourceAutoRelease src = obs_frontend_get_current_scene();
@@ -71,6 +72,8 @@ void SceneItem::MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
                 obs_frontend_set_current_scene(m_src);
         } else if (e.type == QEvent::MouseButtonRelease && m_lmb_down) {
             m_lmb_down = false;
+            auto switchOnClick = config_get_bool(obs_frontend_get_app_config(), "BasicWindow",
+                "MultiviewMouseSwitch");
             if (obs_frontend_preview_program_mode_active()) {
                 if (!switchOnClick)
                     return;
@@ -90,27 +93,30 @@ void SceneItem::MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
     }
 }
 
-void SceneItem::Render(DurchblickItemConfig const& cfg)
+void SceneItem::MouseLeave()
 {
-    SourceItem::Render(cfg);
+    SourceItem::MouseLeave();
+    m_lmb_down = false;
+}
+
+void SceneItem::Render(DurchblickItemConfig const& cfg, RenderData const& rd)
+{
+    SourceItem::Render(cfg, rd);
 
     if (m_indicator_type == Indicator::ICON) {
-        auto color = GetIndicatorColor();
+        auto color = GetIndicatorColor(rd);
         // Draw indicator, to show that this scene is on preview/program
         if (color != 0) {
-            gs_matrix_push();
-            gs_matrix_translate3f(cfg.cx / 16, cfg.cy / 16, 0);
-            DrawBox(cfg.cx / 32, cfg.cx / 32, color);
-            gs_matrix_pop();
+            QueueBox(cfg.cx / 16, cfg.cy / 16, cfg.cx / 32, cfg.cx / 32, color);
         }
     }
 }
 
-uint32_t SceneItem::GetFillColor()
+uint32_t SceneItem::GetFillColor(RenderData const& rd)
 {
     if (m_indicator_type == Indicator::BORDER)
-        return GetIndicatorColor();
-    return LayoutItem::GetFillColor();
+        return GetIndicatorColor(rd);
+    return LayoutItem::GetFillColor(rd);
 }
 
 void SceneItem::ReadFromJson(QJsonObject const& Obj)
@@ -33,6 +33,7 @@ public:
     QComboBox* m_combo_box;
     QRadioButton *m_icon, *m_border, *m_none;
     QDoubleSpinBox* m_font_size;
+    QComboBox* m_refresh_rate;
     SceneItemWidget(QWidget* parent = nullptr)
         : QWidget(parent)
     {
@@ -49,6 +50,8 @@ public:
         m_font_size->setDecimals(0);
         l->addRow(T_SCENE_NAME, m_combo_box);
         l->addRow(T_FONT_SIZE, m_font_size);
+        m_refresh_rate = CreateRefreshRateBox(this);
+        l->addRow(T_REFRESH_RATE, m_refresh_rate);
 
         auto* radio_buttons = new QVBoxLayout(this);
         m_border = new QRadioButton(T_BORDER_INDICATOR, this);
@@ -74,16 +77,12 @@ class SceneItem : public SourceItem {
     } m_indicator_type
         = Indicator::BORDER;
 
-    uint32_t GetIndicatorColor()
+    static uint32_t GetIndicatorColor(RenderData const& rd)
     {
-        OBSSourceAutoRelease previewSrc = obs_frontend_get_current_preview_scene();
-        OBSSourceAutoRelease programSrc = obs_frontend_get_current_scene();
-        bool studioMode = obs_frontend_preview_program_mode_active();
-
-        if (m_src == programSrc)
+        if (rd.source == rd.frame->program)
             return COLOR_PROGRAM_INDICATOR;
-        else if (m_src == previewSrc)
-            return studioMode ? COLOR_PREVIEW_INDICATOR : COLOR_PROGRAM_INDICATOR;
+        else if (rd.source == rd.frame->preview)
+            return rd.frame->studio_mode ? COLOR_PREVIEW_INDICATOR : COLOR_PROGRAM_INDICATOR;
         return 0;
     }
 
@@ -100,9 +99,11 @@ public:
     QWidget* GetConfigWidget() override;
     void LoadConfigFromWidget(QWidget*) override;
     void MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg) override;
-    void Render(DurchblickItemConfig const& cfg) override;
-    uint32_t GetFillColor() override;
+    void MouseLeave() override;
+    void Render(DurchblickItemConfig const& cfg, RenderData const& rd) override;
+    uint32_t GetFillColor(RenderData const& rd) override;
     void ReadFromJson(QJsonObject const& Obj) override;
     void WriteToJson(QJsonObject& Obj) override;
     bool EnableVolumeMeter() const override { return false; }
+    Priority RenderPriority(RenderData const& rd) override { return GetIndicatorColor(rd) ? PRIORITY_LIVE : PRIORITY_STATIC; }
 };
@@ -1,6 +1,7 @@
 #include "source_item.hpp"
 #include "../layout.hpp"
 #include "../util/display_helpers.hpp"
+#include "../util/source_index.hpp"
 #include <QApplication>
 #include <QMainWindow>
 #include <obs-frontend-api.h>
@@ -8,17 +9,15 @@
 
 void SourceItem::VolumeToggled(bool state)
 {
-    if (state && m_src) {
-        auto h = obs_source_get_height(m_src);
-        m_vol_meter = std::make_unique<MixerMeter>(m_src, m_volume_meter_x, m_volume_meter_y, h / 2);
-        m_vol_meter->SetType(OBS_FADER_LOG);
-        m_vol_meter->SetSource(m_src);
+    if (state) {
+        if (m_materialized)
+            CreateVolumeMeter();
     } else {
         if (m_vol_meter) {
             m_volume_meter_x = m_vol_meter->GetX();
             m_volume_meter_y = m_vol_meter->GetY();
         }
-        m_vol_meter = nullptr;
+        std::atomic_store(&m_vol_meter, {});
     }
 }
 
@@ -74,9 +73,73 @@ void SourceItem::Deinit()
 void SourceItem::OBSSourceRemoved(void* data, calldata_t*)
 {
     SourceItem* window = reinterpret_cast<SourceItem*>(data);
-    window->m_src = placeholder_source;
-    if (window->m_vol_meter)
-        window->m_vol_meter->SetSource(placeholder_source);
+    // The layout snapshot keeps the removed source alive until the UI thread replaced it
+    QMetaObject::invokeMethod(
+        window, [window] {
+            window->SetSource(placeholder_source);
+            window->m_layout->RefreshRenderState();
+        },
+        Qt::QueuedConnection);
+}
+
+void SourceItem::OBSSourceRenamed(void* data, calldata_t*)
+{
+    SourceItem* window = reinterpret_cast<SourceItem*>(data);
+    QMetaObject::invokeMethod(window, &SourceItem::UpdateLabel, Qt::QueuedConnection);
+}
+
+void SourceItem::UpdateLabel()
+{
+    if (!m_src || !m_materialized || !m_toggle_label->isChecked())
+        return;
+
+    struct obs_video_info ovi;
+    obs_get_video_info(&ovi);
+    std::atomic_store(&m_label, CreateLabel(obs_source_get_name(m_src), ovi.base_height / 1.5, m_font_scale));
+}
+
+void SourceItem::CreateVolumeMeter()
+{
+    if (!m_src || m_src == placeholder_source)
+        return;
+
+    auto h = obs_source_get_height(m_src);
+    auto meter = std::make_shared<MixerMeter>(m_src, m_volume_meter_x, m_volume_meter_y,
+        int(h * m_volume_meter_height), m_channel_width);
+    meter->SetType(OBS_FADER_LOG);
+    meter->SetSource(m_src);
+    std::atomic_store(&m_vol_meter, std::move(meter));
+}
+
+void SourceItem::ApplyVolumeMeter(bool show)
+{
+    // toggled() only fires on a change, an existing meter is rebuilt to pick up new settings
+    if (m_toggle_volume->isChecked() != show)
+        m_toggle_volume->setChecked(show);
+    else if (show && m_materialized)
+        CreateVolumeMeter();
+}
+
+void SourceItem::Materialize()
+{
+    UpdateLabel();
+    if (m_toggle_volume->isChecked())
+        CreateVolumeMeter();
+}
+
+void SourceItem::Release()
+{
+    std::atomic_store(&m_label, {});
+    VolumeToggled(false);
+    m_throttled.Free();
+    m_watcher.Free();
+}
+
+void SourceItem::SetMaxFps(int fps)
+{
+    m_max_fps = fps;
+    for (auto* action : m_refresh_rates->actions())
+        action->setChecked(action->data().toInt() == fps);
 }
 
 SourceItem::SourceItem(Layout* parent, int x, int y, int w, int h)
@@ -89,9 +152,27 @@ SourceItem::SourceItem(Layout* parent, int x, int y, int w, int h)
     m_toggle_label->setCheckable(true);
     m_toggle_volume = new QAction(T_SOURCE_ITEM_VOLUME, this);
     m_toggle_volume->setCheckable(true);
+    m_toggle_detect_static = new QAction(T_SOURCE_ITEM_DETECT_STATIC, this);
+    m_toggle_detect_static->setCheckable(true);
+    connect(m_toggle_detect_static, &QAction::toggled, this, [this](bool checked) { m_detect_static = checked; });
+    connect(m_toggle_safe_borders, &QAction::toggled, this, [this](bool checked) { m_show_safe_borders = checked; });
+    connect(m_toggle_label, &QAction::toggled, this, [this](bool checked) {
+        m_show_label = checked;
+        if (checked && !m_label)
+            UpdateLabel();
+    });
     SetSource(placeholder_source);
     m_toggle_label->setChecked(true);
     connect(m_toggle_volume, SIGNAL(toggled(bool)), this, SLOT(VolumeToggled(bool)));
+
+    m_refresh_rates = new QActionGroup(this);
+    for (int fps : RefreshRates) {
+        auto* action = m_refresh_rates->addAction(RefreshRateName(fps));
+        action->setCheckable(true);
+        action->setData(fps);
+        action->setChecked(fps == 0);
+    }
+    connect(m_refresh_rates, &QActionGroup::triggered, this, [this](QAction* action) { m_max_fps = action->data().toInt(); });
 }
 
 SourceItem::~SourceItem()
@@ -129,12 +210,9 @@ void SourceItem::LoadConfigFromWidget(QWidget* w)
         m_font_scale = custom->m_font_size->value() / 100.f;
         m_channel_width = custom->m_channel_width->value();
         m_volume_meter_height = custom->m_volume_meter_height->value() / 100.f;
-        m_toggle_volume->setChecked(custom->m_show_volume_meter->isChecked());
-        if (src && custom->m_show_volume_meter->isChecked()) {
-            auto h = obs_source_get_height(src);
-            m_vol_meter = std::make_unique<MixerMeter>(src.Get(), 10, 10, int(h * m_volume_meter_height));
-        }
+        SetMaxFps(custom->m_refresh_rate->currentData().toInt());
         SetSource(src);
+        ApplyVolumeMeter(custom->m_show_volume_meter->isChecked());
     }
 }
 
@@ -149,14 +227,11 @@ void SourceItem::SetSource(obs_source_t* src)
             m_vol_meter->SetSource(src);
         removedSignal = OBSSignal(obs_source_get_signal_handler(m_src), "remove",
             SourceItem::OBSSourceRemoved, this);
+        renamedSignal = OBSSignal(obs_source_get_signal_handler(m_src), "rename",
+            SourceItem::OBSSourceRenamed, this);
+        m_watcher.Watch(m_src);
         obs_source_inc_showing(m_src);
-        if (m_toggle_label->isChecked()) {
-            struct obs_video_info ovi;
-            obs_get_video_info(&ovi);
-
-            uint32_t h = ovi.base_height;
-            m_label = CreateLabel(obs_source_get_name(m_src), h / 1.5, m_font_scale);
-        }
+        UpdateLabel();
     }
 }
 
@@ -165,10 +240,11 @@ void SourceItem::ReadFromJson(QJsonObject const& Obj)
     LayoutItem::ReadFromJson(Obj);
     m_toggle_safe_borders->setChecked(Obj["show_safe_borders"].toBool());
     m_toggle_label->setChecked(Obj["show_label"].toBool());
-    m_toggle_volume->setChecked(Obj["show_volume"].toBool());
+    m_toggle_detect_static->setChecked(Obj["detect_static"].toBool(false));
 
     if (Obj["font_scale"].isDouble())
         m_font_scale = Obj["font_scale"].toDouble(1);
+    SetMaxFps(Obj["max_fps"].toInt(0));
 
     if (Obj["volume_meter_channel_width"].isDouble())
         m_channel_width = Obj["volume_meter_channel_width"].toInt(2);
@@ -181,27 +257,29 @@ void SourceItem::ReadFromJson(QJsonObject const& Obj)
     if (Obj["volume_meter_y"].isDouble())
         m_volume_meter_y = Obj["volume_meter_y"].toDouble(10);
 
-    OBSSourceAutoRelease src = obs_get_source_by_name(qt_to_utf8(Obj["source"].toString()));
+    OBSSourceAutoRelease src = SourceIndex::Resolve(Obj["source_uuid"].toString(), Obj["source"].toString());
     if (src)
         SetSource(src);
     else
         SetSource(placeholder_source);
 
-    if (src.Get() && m_toggle_volume->isChecked()) {
-        auto h = obs_source_get_height(src);
-        m_vol_meter = std::make_unique<MixerMeter>(src.Get(), m_volume_meter_x, m_volume_meter_y, int(h * m_volume_meter_height));
-    }
+    // Otherwise the meter is created once the item is drawn
+    ApplyVolumeMeter(Obj["show_volume"].toBool());
 }
 
 void SourceItem::WriteToJson(QJsonObject& Obj)
 {
     LayoutItem::WriteToJson(Obj);
-    if (m_src)
+    if (m_src && m_src != placeholder_source) {
         Obj["source"] = utf8_to_qt(obs_source_get_name(m_src));
+        Obj["source_uuid"] = utf8_to_qt(obs_source_get_uuid(m_src));
+    }
     Obj["show_safe_borders"] = m_toggle_safe_borders->isChecked();
     Obj["show_label"] = m_toggle_label->isChecked();
     Obj["show_volume"] = m_toggle_volume->isChecked();
+    Obj["detect_static"] = m_toggle_detect_static->isChecked();
     Obj["font_scale"] = m_font_scale;
+    Obj["max_fps"] = m_max_fps.load();
     Obj["volume_meter_channel_width"] = m_channel_width;
     Obj["volume_meter_height"] = m_volume_meter_height;
 
@@ -216,59 +294,93 @@ void SourceItem::WriteToJson(QJsonObject& Obj)
 
 static const uint32_t labelColor = 0xD91F1F1F;
 
-void SourceItem::Render(DurchblickItemConfig const& cfg)
+vec2 SourceItem::SourceScale(uint32_t w, uint32_t h, int inner_width, int inner_height, int& offset_x, int& offset_y) const
+{
+    vec2 scale {};
+    offset_x = offset_y = 0;
+    if (m_stretch) {
+        scale.x = inner_width / float(w);
+        scale.y = inner_height / float(h);
+    } else {
+        GetScaleAndCenterPos(w, h, inner_width, inner_height, offset_x, offset_y, scale.x);
+        scale.y = scale.x;
+    }
+    return scale;
+}
+
+void SourceItem::Render(DurchblickItemConfig const& cfg, RenderData const& rd)
 {
-    LayoutItem::Render(cfg);
+    LayoutItem::Render(cfg, rd);
 
-    if (!m_src)
+    obs_source_t* src = rd.source;
+    if (!src)
         return;
 
-    auto w = obs_source_get_width(m_src);
-    auto h = obs_source_get_height(m_src);
+    auto w = obs_source_get_width(src);
+    auto h = obs_source_get_height(src);
     int offset_x {}, offset_y {};
-
-    if (m_toggle_stretch->isChecked()) {
-        m_scale.x = m_inner_width / float(w);
-        m_scale.y = m_inner_height / float(h);
-    } else {
-        GetScaleAndCenterPos(w, h, m_inner_width, m_inner_height, offset_x, offset_y, m_scale.x);
-        m_scale.y = m_scale.x;
-    }
+    auto scale = SourceScale(w, h, rd.inner_width, rd.inner_height, offset_x, offset_y);
 
     gs_matrix_push();
     gs_matrix_translate3f(offset_x, offset_y, 0);
-    gs_matrix_scale3f(m_scale.x, m_scale.y, 1);
-    obs_source_video_render(m_src);
-    if (m_toggle_safe_borders->isChecked())
+    gs_matrix_scale3f(scale.x, scale.y, 1);
+    auto refresh = ThrottledTexture::Refresh::Auto;
+    if (m_render_mode == RENDER_CACHED)
+        refresh = ThrottledTexture::Refresh::Skip;
+    else if (m_render_mode == RENDER_REFRESH)
+        refresh = ThrottledTexture::Refresh::Force;
+
+    // Changing content keeps the usual path (direct at full rate), only probes go through the texture
+    bool probe = false;
+    if (m_render_mode == RENDER_FULL && m_detect_static) {
+        switch (m_watcher.Check(src)) {
+        case ContentWatcher::State::Static:
+            refresh = ThrottledTexture::Refresh::Skip;
+            break;
+        case ContentWatcher::State::Probe:
+            // A limited refresh rate also limits probing
+            probe = true;
+            if (m_max_fps <= 0)
+                refresh = ThrottledTexture::Refresh::Force;
+            break;
+        case ContentWatcher::State::Changing:
+            break;
+        }
+    }
+
+    // Size on screen, so a source shown in several cells is cached only as large as needed
+    uint32_t const cx = uint32_t(w * scale.x * cfg.scale + 0.5f);
+    uint32_t const cy = uint32_t(h * scale.y * cfg.scale + 0.5f);
+    if (m_throttled.Render(src, cx, cy, m_max_fps, refresh) && probe)
+        m_watcher.Rendered(m_throttled.Texture(), m_throttled.Width(), m_throttled.Height());
+    if (m_show_safe_borders)
         RenderSafeMargins(w, h);
     gs_matrix_pop();
 
-    if (m_vol_meter && obs_source_active(m_src))
-        m_vol_meter->Render(cfg.scale, m_scale.x, m_scale.y);
+    auto vol_meter = std::atomic_load(&m_vol_meter);
+    if (vol_meter && obs_source_active(src))
+        vol_meter->Render(cfg.scale, scale.x, scale.y);
 
     // Label has to be scaled and translated regardless of
     // source/scene size because sources can have sizes different than the base canvas
-    if (m_toggle_label->isChecked() && m_label) {
+    auto label = std::atomic_load(&m_label);
+    if (m_show_label && label && label->Ready()) {
         float label_scale = 1;
         int tmp_x {}, tmp_y {};
-        auto lw = obs_source_get_width(m_label);
-        auto lh = obs_source_get_height(m_label);
-
-        if (lw == 0 || lh == 0)
-            return;
+        auto lw = label->Width();
+        auto lh = label->Height();
 
-        GetScaleAndCenterPos(cfg.canvas_width, cfg.canvas_height, m_inner_width, m_inner_height, tmp_x, tmp_y, label_scale);
+        GetScaleAndCenterPos(cfg.canvas_width, cfg.canvas_height, rd.inner_width, rd.inner_height, tmp_x, tmp_y, label_scale);
 
         gs_matrix_push();
         // This is very convoluted, but I don't have a better way of doing this
         // Basically puts the label horziontally centered at the bottom of the source/scene with an offset from the bottom of 1.5 times the height of the label
         // The scale is the same as with the builtin multiview and uses the scale that a rectangle with the base canvas aspect ratio would need
         // this prevents the labels from getting too big/small (usually)
-        gs_matrix_translate3f((m_inner_width - lw * label_scale) / 2, offset_y + h * m_scale.y - lh * label_scale * 1.5, 0);
+        gs_matrix_translate3f((rd.inner_width - lw * label_scale) / 2, offset_y + h * scale.y - lh * label_scale * 1.5, 0);
         gs_matrix_scale3f(label_scale, label_scale, 1);
-        DrawBox(lw, lh, labelColor);
-        gs_matrix_translate3f(0, -(lh * 0.08), 0.0f);
-        obs_source_video_render(m_label);
+        QueueBox(0, 0, lw, lh, labelColor, DrawList::LAYER_LABEL);
+        label->Draw();
         gs_matrix_pop();
     }
 }
@@ -280,13 +392,18 @@ void SourceItem::ContextMenu(QMenu& m)
     m.addAction(m_toggle_label);
     if (EnableVolumeMeter())
         m.addAction(m_toggle_volume);
+    if (EnableRefreshRate()) {
+        m.addAction(m_toggle_detect_static);
+        m.addMenu(T_REFRESH_RATE)->addActions(m_refresh_rates->actions());
+    }
 }
 
 void SourceItem::MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
 {
     LayoutItem::MouseEvent(e, cfg);
     if (m_vol_meter) {
-        if (e.buttons & Qt::LeftButton && m_mouse_over) {
+        // Once a drag started, the captured mouse keeps moving the meter outside of the cell
+        if (e.buttons & Qt::LeftButton && (m_dragging_volume || m_mouse_over)) {
             if (m_vol_meter->MouseOver(m_mouse_x, m_mouse_y)) {
                 if (!m_dragging_volume) {
                     m_dragging_volume = true;
@@ -296,8 +413,11 @@ void SourceItem::MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
             }
 
             if (m_dragging_volume) {
-                auto x = qBound(0, m_mouse_x - m_drag_start_x, qMax(int(m_width - m_vol_meter->GetWidth() * m_scale.x), 1));
-                auto y = qBound(0, m_mouse_y - m_drag_start_y, qMax(int(m_height - m_vol_meter->GetHeight() * m_scale.y), 1));
+                int offset_x {}, offset_y {};
+                auto scale = SourceScale(obs_source_get_width(m_src), obs_source_get_height(m_src),
+                    m_inner_width, m_inner_height, offset_x, offset_y);
+                auto x = qBound(0, m_mouse_x - m_drag_start_x, qMax(int(m_width - m_vol_meter->GetWidth() * scale.x), 1));
+                auto y = qBound(0, m_mouse_y - m_drag_start_y, qMax(int(m_height - m_vol_meter->GetHeight() * scale.y), 1));
                 m_vol_meter->SetPos(x, y);
             }
         } else {
@@ -305,3 +425,9 @@ void SourceItem::MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg)
         }
     }
 }
+
+void SourceItem::MouseLeave()
+{
+    LayoutItem::MouseLeave();
+    m_dragging_volume = false;
+}
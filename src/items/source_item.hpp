@@ -17,9 +17,13 @@
  *************************************************************************/
 
 #pragma once
+#include "../util/content_watcher.hpp"
+#include "../util/labels.hpp"
+#include "../util/source_cache.hpp"
 #include "../util/util.h"
 #include "../util/volume_meter.hpp"
 #include "item.hpp"
+#include <QActionGroup>
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDoubleSpinBox>
@@ -29,40 +33,26 @@
 #include <mutex>
 #include <obs.hpp>
 
-/* yoinked from obs window-projector.cpp */
-static inline OBSSource CreateLabel(char const* name, size_t h, float scale)
+/// Font size matches the text sources the builtin multiview uses, see Labels::Get
+static inline std::shared_ptr<Labels::Label> CreateLabel(char const* name, size_t h, float scale)
 {
-    OBSDataAutoRelease settings = obs_data_create();
-    OBSDataAutoRelease font = obs_data_create();
-
-    std::string text;
-    text += " ";
-    text += name;
-    text += " ";
-
-#if defined(_WIN32)
-    obs_data_set_string(font, "face", "Arial");
-#elif defined(__APPLE__)
-    obs_data_set_string(font, "face", "Helvetica");
-#else
-    obs_data_set_string(font, "face", "Monospace");
-#endif
-    obs_data_set_int(font, "flags", 1); // Bold text
-    obs_data_set_int(font, "size", int(h / 9.81) * scale);
-
-    obs_data_set_obj(settings, "font", font);
-    obs_data_set_string(settings, "text", text.c_str());
-    obs_data_set_bool(settings, "outline", false);
-
-#ifdef _WIN32
-    const char* text_source_id = "text_gdiplus";
-#else
-    const char* text_source_id = "text_ft2_source";
-#endif
-
-    OBSSourceAutoRelease txtSource = obs_source_create_private(text_source_id, name, settings);
-
-    return txtSource.Get();
+    return Labels::Get(name, int(h / 9.81) * scale);
+}
+
+/// Choices for the max refresh rate of a cell, 0 renders every frame
+static constexpr int RefreshRates[] = { 0, 30, 15, 5, 1 };
+
+static inline QString RefreshRateName(int fps)
+{
+    return fps > 0 ? QString(T_REFRESH_RATE_FPS).arg(fps) : QString(T_REFRESH_RATE_FULL);
+}
+
+static inline QComboBox* CreateRefreshRateBox(QWidget* parent)
+{
+    auto* box = new QComboBox(parent);
+    for (int fps : RefreshRates)
+        box->addItem(RefreshRateName(fps), fps);
+    return box;
 }
 
 class SourceItemWidget : public QWidget {
@@ -73,6 +63,7 @@ public:
     QCheckBox* m_show_volume_meter;
     QSpinBox* m_channel_width;
     QDoubleSpinBox* m_volume_meter_height;
+    QComboBox* m_refresh_rate;
     SourceItemWidget(QWidget* parent = nullptr)
         : QWidget(parent)
     {
@@ -96,8 +87,10 @@ public:
         m_volume_meter_height->setSuffix("%");
         m_channel_width->setMinimum(2);
         m_channel_width->setMaximum(32);
+        m_refresh_rate = CreateRefreshRateBox(this);
         l->addRow(T_SOURCE_NAME, m_combo_box);
         l->addRow(T_FONT_SIZE, m_font_size);
+        l->addRow(T_REFRESH_RATE, m_refresh_rate);
         l->addRow("", m_show_volume_meter);
         l->addRow(T_CHANNEL_WIDTH, m_channel_width);
         l->addRow(T_VOLUME_METER_HEIGHT, m_volume_meter_height);
@@ -111,26 +104,42 @@ protected:
     bool m_dragging_volume {};
     int m_drag_start_x {}, m_drag_start_y {};
     OBSSource m_src;
-    OBSSourceAutoRelease m_label;
+    std::shared_ptr<Labels::Label> m_label; // Swapped atomically, the graphics thread draws it
     OBSSignal removedSignal;
+    OBSSignal renamedSignal;
     QAction* m_toggle_safe_borders;
     QAction* m_toggle_label;
     QAction* m_toggle_volume;
-    std::unique_ptr<MixerMeter> m_vol_meter {};
+    QAction* m_toggle_detect_static;
+    QActionGroup* m_refresh_rates;
+    std::atomic<bool> m_show_safe_borders {}, m_show_label {}; // Read by the graphics thread
+    std::shared_ptr<MixerMeter> m_vol_meter {}; // Swapped atomically, the graphics thread draws it
+    std::atomic<int> m_max_fps {}; // Read by the graphics thread, 0 renders every frame
+    ThrottledTexture m_throttled;  // Last render of the source when the refresh rate is limited or it is static
+    ContentWatcher m_watcher;
+    std::atomic<bool> m_detect_static {}; // Read by the graphics thread
     float m_font_scale { 1 };
     float m_volume_meter_height { .5 };
     int m_volume_meter_x { 10 }, m_volume_meter_y { 10 };
     int m_channel_width { 2 };
     void RenderSafeMargins(int w, int h);
-    vec2 m_scale {};
+    void CreateVolumeMeter();
+    void ApplyVolumeMeter(bool show);
+    /// Scale and offset of a w x h source inside the cell, depending on the stretch setting
+    vec2 SourceScale(uint32_t w, uint32_t h, int inner_width, int inner_height, int& offset_x, int& offset_y) const;
+
+    void Materialize() override;
+    void Release() override;
 public slots:
 
     void VolumeToggled(bool);
+    virtual void UpdateLabel();
 
 public:
     static void Init();
     static void Deinit();
     static void OBSSourceRemoved(void* data, calldata_t* params);
+    static void OBSSourceRenamed(void* data, calldata_t* params);
     SourceItem(Layout* parent, int x, int y, int w = 1, int h = 1);
     ~SourceItem();
 
@@ -149,18 +158,31 @@ public:
         m_toggle_volume->setChecked(b);
     }
 
+    void SetMaxFps(int fps);
+
+    void SetDetectStatic(bool b)
+    {
+        m_toggle_detect_static->setChecked(b);
+    }
+
     void SetSafeBorders(bool b)
     {
         m_toggle_safe_borders->setChecked(b);
     }
 
     OBSSource GetSource() { return m_src; }
+    obs_source_t* RenderSource() override { return m_src; }
 
     virtual void ReadFromJson(QJsonObject const& Obj) override;
     virtual void WriteToJson(QJsonObject& Obj) override;
-    virtual void Render(DurchblickItemConfig const& cfg) override;
+    virtual void Render(DurchblickItemConfig const& cfg, RenderData const& rd) override;
     virtual void ContextMenu(QMenu&) override;
     virtual void MouseEvent(MouseData const& e, DurchblickItemConfig const& cfg) override;
+    virtual void MouseLeave() override;
 
     virtual bool EnableVolumeMeter() const { return true; }
+    virtual bool EnableRefreshRate() const { return true; }
+
+    Priority RenderPriority(RenderData const&) override { return PRIORITY_STATIC; }
+    bool CanRenderCached() const override { return true; }
 };
@@ -21,39 +21,116 @@
 #include "items/preview_program_item.hpp"
 #include "items/scene_item.hpp"
 #include "ui/durchblick.hpp"
+#include "util/source_index.hpp"
 #include "util/util.h"
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QThread>
 #include <obs-frontend-api.h>
 #include <util/config-file.h>
+#include <util/platform.h>
 
 void Layout::FillEmptyCells()
 {
     // Make sure that every cell has a placeholder
-    std::vector<LayoutItem::Cell> empty;
-    for (int x = 0; x < m_cols; x++) {
-        for (int y = 0; y < m_rows; y++) {
-            LayoutItem::Cell c;
-            c.col = x;
-            c.row = y;
-            bool isFree = true;
-            for (auto const& item : m_layout_items) {
-                if (c.Overlaps(item->m_cell)) {
-                    isFree = false;
-                    break;
-                }
-            }
+    for (int y = 0; y < m_rows; y++) {
+        for (int x = 0; x < m_cols; x++) {
+            if (ItemAt(x, y))
+                continue;
+            auto* Item = new PlaceholderItem(this, x, y);
+            Item->Update(m_cfg);
+            AddItem(Item);
+        }
+    }
+}
 
-            if (isFree)
-                empty.emplace_back(c);
+static void DeleteItem(LayoutItem* item)
+{
+    // The graphics thread can drop the last reference to an item
+    // if it was still rendering an old layout state
+    if (QThread::currentThread() == item->thread())
+        delete item;
+    else
+        item->deleteLater();
+}
+
+void Layout::PublishRenderState()
+{
+    auto state = std::make_shared<RenderState>();
+    state->cfg = m_cfg;
+    state->dragging = m_dragging;
+    if (m_dragging)
+        GetSelection(state->sel_x, state->sel_y, state->sel_cx, state->sel_cy);
+
+    state->items.reserve(m_layout_items.size());
+    for (auto const& item : m_layout_items) {
+        state->items.push_back({ item, item->m_rel_left, item->m_rel_top, item->m_width, item->m_height,
+            { OBSSource(item->RenderSource()), item->m_inner_width, item->m_inner_height, &m_scheduler.frame } });
+    }
+    std::atomic_store(&m_render_state, std::shared_ptr<RenderState const>(std::move(state)));
+}
+
+void Layout::PublishSelection()
+{
+    // Mouse movement only needs a new state if the selection rectangle changed
+    int tx {}, ty {}, cx {}, cy {};
+    if (m_dragging)
+        GetSelection(tx, ty, cx, cy);
+
+    auto state = std::atomic_load(&m_render_state);
+    if (state && state->dragging == m_dragging && state->sel_x == tx && state->sel_y == ty && state->sel_cx == cx && state->sel_cy == cy)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_layout_mutex);
+    PublishRenderState();
+}
+
+void Layout::AddItem(LayoutItem* item)
+{
+    m_layout_items.emplace_back(item, DeleteItem);
+    MarkCells(item->m_cell, item);
+}
+
+void Layout::MarkCells(LayoutItem::Cell const& c, LayoutItem* owner)
+{
+    if (m_grid.size() != size_t(m_cols * m_rows))
+        return;
+    auto l = qBound(0, c.left(), m_cols), r = qBound(0, c.right(), m_cols);
+    auto t = qBound(0, c.top(), m_rows), b = qBound(0, c.bottom(), m_rows);
+
+    for (int y = t; y < b; y++) {
+        for (int x = l; x < r; x++)
+            m_grid[y * m_cols + x] = owner;
+    }
+}
+
+void Layout::UnmarkCells(LayoutItem* item)
+{
+    if (m_grid.size() != size_t(m_cols * m_rows))
+        return;
+    auto const& c = item->m_cell;
+    auto l = qBound(0, c.left(), m_cols), r = qBound(0, c.right(), m_cols);
+    auto t = qBound(0, c.top(), m_rows), b = qBound(0, c.bottom(), m_rows);
+
+    for (int y = t; y < b; y++) {
+        for (int x = l; x < r; x++) {
+            auto& cell = m_grid[y * m_cols + x];
+            if (cell == item)
+                cell = nullptr;
         }
     }
+}
 
-    for (auto const& c : empty) {
-        auto* Item = new PlaceholderItem(this, c.col, c.row);
-        Item->Update(m_cfg);
-        m_layout_items.emplace_back(Item);
+void Layout::RebuildGrid()
+{
+    // Items might have been removed, so nothing can stay hovered or captured
+    m_hovered_item = nullptr;
+    m_captured_item = nullptr;
+    m_grid.assign(size_t(qMax(m_cols, 0) * qMax(m_rows, 0)), nullptr);
+    for (auto const& item : m_layout_items) {
+        if (item)
+            MarkCells(item->m_cell, item.get());
     }
 }
 
@@ -78,6 +155,7 @@ void Layout::ClearSelection()
     m_layout_mutex.lock();
     FreeSpace(target);
     FillEmptyCells();
+    PublishRenderState();
     m_layout_mutex.unlock();
     Config::Save();
 }
@@ -136,10 +214,11 @@ void Layout::FillSelectionWithScenes()
             Item->Update(m_cfg);
             Item->SetSource(src);
             FreeSpace(c);
-            m_layout_items.emplace_back(Item);
+            AddItem(Item);
             cells_to_fill--;
         }
         FillEmptyCells();
+        PublishRenderState();
         obs_frontend_source_list_free(&scenes);
     }
     Config::Save();
@@ -157,6 +236,49 @@ Layout::~Layout()
 {
 }
 
+LayoutItem* Layout::ItemAtPos(int x, int y) const
+{
+    if (x < 0 || y < 0 || m_cfg.cell_width <= 0 || m_cfg.cell_height <= 0)
+        return nullptr;
+    return ItemAt(int(x / m_cfg.cell_width), int(y / m_cfg.cell_height));
+}
+
+void Layout::RouteMouseEvent(LayoutItem::MouseData const& d)
+{
+    // Only mouse movement changes which item is hovered, clicks go to the item under the cursor
+    if (d.type == QEvent::MouseMove) {
+        auto* hovered = ItemAtPos(d.x, d.y);
+        if (hovered != m_hovered_item) {
+            // The captured item is only left once the capture ends, so drags don't stop at the border
+            if (m_hovered_item && m_hovered_item != m_captured_item)
+                m_hovered_item->MouseLeave();
+            m_hovered_item = hovered;
+        }
+
+        // Lost the release event somewhere (e.g. a context menu was opened)
+        if (m_captured_item && !d.buttons)
+            ReleaseCapture();
+    }
+
+    // Items that were pressed keep receiving events until all buttons are released
+    // so that dragging a fader or meter doesn't stop at the cell border
+    auto* target = m_captured_item ? m_captured_item : m_hovered_item;
+    if (target)
+        target->MouseEvent(d, m_cfg);
+
+    if (d.type == QEvent::MouseButtonPress && !m_captured_item)
+        m_captured_item = m_hovered_item;
+    else if (d.type == QEvent::MouseButtonRelease && !d.buttons)
+        ReleaseCapture();
+}
+
+void Layout::ReleaseCapture()
+{
+    if (m_captured_item && m_captured_item != m_hovered_item)
+        m_captured_item->MouseLeave();
+    m_captured_item = nullptr;
+}
+
 void Layout::MouseMoved(QMouseEvent* e)
 {
     LayoutItem::MouseData d(
@@ -172,14 +294,14 @@ void Layout::MouseMoved(QMouseEvent* e)
         d.y *= screen->devicePixelRatio();
     }
 
+    RouteMouseEvent(d);
+
+    // Taken from the grid, the hovered item gets no events while another one has captured the mouse
     LayoutItem::Cell pos;
-    bool anything_hovered = false;
-    for (auto& Item : m_layout_items) {
-        Item->MouseEvent(d, m_cfg);
-        if (Item->Hovered()) {
-            pos = Item->m_hovered_cell;
-            anything_hovered = true;
-        }
+    bool anything_hovered = m_hovered_item != nullptr;
+    if (anything_hovered) {
+        pos.col = int(d.x / m_cfg.cell_width);
+        pos.row = int(d.y / m_cfg.cell_height);
     }
     m_hovered_cell = pos;
     if (anything_hovered && e->buttons() & Qt::RightButton) {
@@ -194,6 +316,7 @@ void Layout::MouseMoved(QMouseEvent* e)
         m_selection_end.clear();
         m_selection_start.clear();
     }
+    PublishSelection();
 }
 
 void Layout::MousePressed(QMouseEvent* e)
@@ -204,8 +327,7 @@ void Layout::MousePressed(QMouseEvent* e)
         e->modifiers(),
         e->buttons(),
         e->type());
-    for (auto& Item : m_layout_items)
-        Item->MouseEvent(d, m_cfg);
+    RouteMouseEvent(d);
     if (e->button() == Qt::RightButton) {
         m_selection_start = m_hovered_cell;
     } else {
@@ -213,6 +335,7 @@ void Layout::MousePressed(QMouseEvent* e)
         m_selection_start.clear();
         m_dragging = false;
     }
+    PublishSelection();
 }
 
 void Layout::MouseReleased(QMouseEvent* e)
@@ -223,9 +346,9 @@ void Layout::MouseReleased(QMouseEvent* e)
         e->modifiers(),
         e->buttons(),
         e->type());
-    for (auto& Item : m_layout_items)
-        Item->MouseEvent(d, m_cfg);
+    RouteMouseEvent(d);
     m_dragging = false;
+    PublishSelection();
 }
 
 void Layout::MouseDoubleClicked(QMouseEvent* e)
@@ -237,8 +360,7 @@ void Layout::MouseDoubleClicked(QMouseEvent* e)
         e->buttons(),
         e->type());
     d.double_click = true;
-    for (auto& Item : m_layout_items)
-        Item->MouseEvent(d, m_cfg);
+    RouteMouseEvent(d);
 }
 
 void Layout::HandleContextMenu(QMouseEvent*, QMenu& m)
@@ -254,26 +376,47 @@ void Layout::HandleContextMenu(QMouseEvent*, QMenu& m)
         m.addAction(T_MENU_CONFIGURATION, this, SLOT(ShowLayoutConfigDialog()));
         m.addAction(T_MENU_LOCK, this, SLOT(Lock()));
         std::lock_guard<std::mutex> lock(m_layout_mutex);
-
-        for (auto& Item : m_layout_items) {
-            if (Item->Hovered()) {
-                auto* sub_menu = m.addMenu(T_MENU_QUICK_ACTIONS);
-                sub_menu->addAction(T_MENU_FILL_ACTION, this, SLOT(FillSelectionWithScenes()));
-                sub_menu->addAction(T_MENU_CLEAR_ACTION, this, SLOT(ClearSelection()));
-                m.addAction(T_MENU_SET_WIDGET, this, SLOT(ShowSetWidgetDialog()));
-                m.addSeparator();
-                Item->ContextMenu(m);
-                break;
-            }
+        PublishRenderState();
+
+        if (m_hovered_item) {
+            auto* sub_menu = m.addMenu(T_MENU_QUICK_ACTIONS);
+            sub_menu->addAction(T_MENU_FILL_ACTION, this, SLOT(FillSelectionWithScenes()));
+            sub_menu->addAction(T_MENU_CLEAR_ACTION, this, SLOT(ClearSelection()));
+            m.addAction(T_MENU_SET_WIDGET, this, SLOT(ShowSetWidgetDialog()));
+            m.addSeparator();
+            m_hovered_item->ContextMenu(m);
         }
     }
 }
 
 void Layout::FreeSpace(LayoutItem::Cell const& c)
 {
-    auto it = std::remove_if(m_layout_items.begin(), m_layout_items.end(), [c](std::unique_ptr<LayoutItem> const& item) {
-        auto result = !item || c.Overlaps(item->m_cell);
-        return result;
+    // Only look at the cells inside the area instead of checking every item
+    std::vector<LayoutItem*> owners;
+    auto l = qBound(0, c.left(), m_cols), r = qBound(0, c.right(), m_cols);
+    auto t = qBound(0, c.top(), m_rows), b = qBound(0, c.bottom(), m_rows);
+
+    for (int y = t; y < b; y++) {
+        for (int x = l; x < r; x++) {
+            auto* owner = ItemAt(x, y);
+            if (owner && std::find(owners.begin(), owners.end(), owner) == owners.end())
+                owners.emplace_back(owner);
+        }
+    }
+
+    if (owners.empty())
+        return;
+
+    for (auto* owner : owners) {
+        UnmarkCells(owner);
+        if (owner == m_hovered_item)
+            m_hovered_item = nullptr;
+        if (owner == m_captured_item)
+            m_captured_item = nullptr;
+    }
+
+    auto it = std::remove_if(m_layout_items.begin(), m_layout_items.end(), [&owners](std::shared_ptr<LayoutItem> const& item) {
+        return !item || std::find(owners.begin(), owners.end(), item.get()) != owners.end();
     });
     m_layout_items.erase(it, m_layout_items.end());
 }
@@ -286,8 +429,9 @@ void Layout::AddWidget(Registry::ItemRegistry::Entry const& entry, const LayoutI
 
     m_layout_mutex.lock();
     FreeSpace(c);
-    m_layout_items.emplace_back(Item);
+    AddItem(Item);
     FillEmptyCells();
+    PublishRenderState();
     m_layout_mutex.unlock();
 
     Config::Save();
@@ -298,12 +442,12 @@ void Layout::AddWidget(Registry::ItemRegistry::Entry const& entry, QWidget* cust
     AddWidget(entry, GetSelectedArea(), custom_widget);
 }
 
-void Layout::SetRegion(float bx, float by, float cx, float cy)
+void Layout::SetRegion(DurchblickItemConfig const& cfg, float bx, float by, float cx, float cy)
 {
-    float vX = int(m_cfg.x + bx * m_cfg.scale);
-    float vY = int(m_cfg.y + by * m_cfg.scale);
-    float vCX = int(cx * m_cfg.scale);
-    float vCY = int(cy * m_cfg.scale);
+    float vX = int(cfg.x + bx * cfg.scale);
+    float vY = int(cfg.y + by * cfg.scale);
+    float vCX = int(cx * cfg.scale);
+    float vCY = int(cy * cfg.scale);
 
     float oL = bx;
     float oT = by;
@@ -312,110 +456,255 @@ void Layout::SetRegion(float bx, float by, float cx, float cy)
     StartRegion(vX, vY, vCX, vCY, oL, oR, oT, oB);
 }
 
-void Layout::Render(int, int, uint32_t, uint32_t)
+void Layout::Render(int, int, uint32_t window_cx, uint32_t window_cy)
 {
     if (!m_durchblick->HasSize()) // We need at least one refresh/resize to be sure that we have all necessary data for rendering
         return;
-    // Define the whole usable region for the multiview
-    StartRegion(m_cfg.x, m_cfg.y, m_cfg.cx * m_cfg.scale, m_cfg.cy * m_cfg.scale, 0.0f, m_cfg.cx,
-        0.0f, m_cfg.cy);
-    LayoutItem::DrawBox(m_cfg.cx, m_cfg.cy, COLOR_BORDER_GRAY);
 
-    m_layout_mutex.lock();
-    for (auto& Item : m_layout_items) {
-        // Change region to item dimensions
-        gs_matrix_push();
-        gs_matrix_translate3f(Item->m_rel_left, Item->m_rel_top, 0);
+    // Keeps the items of this state alive until the frame is done, even if the UI thread replaces them
+    auto state = std::atomic_load(&m_render_state);
+    if (!state)
+        return;
+    auto const& cfg = state->cfg;
 
-        SetRegion(Item->m_rel_left, Item->m_rel_top, Item->m_width, Item->m_height);
+    m_draw_list.Begin(window_cx, window_cy);
 
-        LayoutItem::DrawBox(0, 0, m_cfg.cell_width * Item->m_width, m_cfg.cell_height * Item->m_height, Item->GetFillColor());
+    // Define the whole usable region for the multiview
+    StartRegion(cfg.x, cfg.y, cfg.cx * cfg.scale, cfg.cy * cfg.scale, 0.0f, cfg.cx,
+        0.0f, cfg.cy);
+    LayoutItem::QueueBox(0, 0, cfg.cx, cfg.cy, COLOR_BORDER_GRAY, DrawList::LAYER_BORDER);
+    ScheduleItems(*state);
+
+    // Borders and backgrounds of all cells go out in one batch before any item content
+    for (auto const& Entry : state->items) {
+        LayoutItem::QueueBox(Entry.rel_left, Entry.rel_top, Entry.width, Entry.height,
+            Entry.item->GetFillColor(Entry.data), DrawList::LAYER_BORDER);
+        LayoutItem::QueueBox(Entry.rel_left + cfg.border, Entry.rel_top + cfg.border, Entry.data.inner_width,
+            Entry.data.inner_height, COLOR_BLACK, DrawList::LAYER_BORDER);
+    }
+    m_draw_list.Flush(DrawList::LAYER_BORDER);
 
-        EndRegion();
-        gs_matrix_pop();
+    bool const gpu_timing = m_render_budget_ms > 0 && m_gpu_timing;
+    if (gpu_timing)
+        m_scheduler.gpu.Begin();
 
+    uint64_t frame_ns = 0;
+    for (size_t i = 0; i < state->items.size(); i++) {
+        auto const& Entry = state->items[i];
         gs_matrix_push();
-        gs_matrix_translate3f(Item->m_rel_left + m_cfg.border, Item->m_rel_top + m_cfg.border, 0);
-        SetRegion(Item->m_rel_left + m_cfg.border, Item->m_rel_top + m_cfg.border, Item->m_inner_width, Item->m_inner_height);
-        Item->Render(m_cfg);
+        gs_matrix_translate3f(Entry.rel_left + cfg.border, Entry.rel_top + cfg.border, 0);
+        SetRegion(cfg, Entry.rel_left + cfg.border, Entry.rel_top + cfg.border, Entry.data.inner_width, Entry.data.inner_height);
+        Entry.item->EnsureMaterialized();
+
+        uint64_t const start = os_gettime_ns();
+        Entry.item->Render(cfg, Entry.data);
+        uint64_t const ns = os_gettime_ns() - start;
+        frame_ns += ns;
+
+        // Drawing from the cache says nothing about the cost of the item itself
+        auto& cost = Entry.item->m_render_cost_ns;
+        if (m_scheduler.modes[i] != LayoutItem::RENDER_CACHED)
+            cost = cost ? (cost * 3 + ns) / 4 : ns;
         EndRegion();
         gs_matrix_pop();
     }
-    m_layout_mutex.unlock();
 
-    if (m_dragging) {
-        int tx, ty, cx, cy;
-        GetSelection(tx, ty, cx, cy);
+    if (gpu_timing)
+        m_scheduler.gpu.End(frame_ns);
+    RenderThrottledOverlay(*state);
+
+    if (state->dragging) {
+        int tx = state->sel_x, ty = state->sel_y, cx = state->sel_cx, cy = state->sel_cy;
+        auto const overlay = DrawList::LAYER_OVERLAY;
         // Draw Selection rectangle
 
         // Top
-        LayoutItem::DrawBox(tx * m_cfg.cell_width, ty * m_cfg.cell_height - 1, cx * m_cfg.cell_width - 1, m_cfg.border + 1, COLOR_SELECTION_CYAN);
+        LayoutItem::QueueBox(tx * cfg.cell_width, ty * cfg.cell_height - 1, cx * cfg.cell_width - 1, cfg.border + 1, COLOR_SELECTION_CYAN, overlay);
 
         // Bottom
-        LayoutItem::DrawBox(tx * m_cfg.cell_width, (ty + cy) * m_cfg.cell_height - m_cfg.border - 2, cx * m_cfg.cell_width - 1, m_cfg.border + 2, COLOR_SELECTION_CYAN);
+        LayoutItem::QueueBox(tx * cfg.cell_width, (ty + cy) * cfg.cell_height - cfg.border - 2, cx * cfg.cell_width - 1, cfg.border + 2, COLOR_SELECTION_CYAN, overlay);
 
         // Left
-        LayoutItem::DrawBox(tx * m_cfg.cell_width, ty * m_cfg.cell_height, m_cfg.border, cy * m_cfg.cell_height - 1, COLOR_SELECTION_CYAN);
+        LayoutItem::QueueBox(tx * cfg.cell_width, ty * cfg.cell_height, cfg.border, cy * cfg.cell_height - 1, COLOR_SELECTION_CYAN, overlay);
 
         // Right
-        LayoutItem::DrawBox((tx + cx) * m_cfg.cell_width - m_cfg.border - 2, ty * m_cfg.cell_height, m_cfg.border + 1, cy * m_cfg.cell_height - 1, COLOR_SELECTION_CYAN);
+        LayoutItem::QueueBox((tx + cx) * cfg.cell_width - cfg.border - 2, ty * cfg.cell_height, cfg.border + 1, cy * cfg.cell_height - 1, COLOR_SELECTION_CYAN, overlay);
     }
     EndRegion();
+    m_draw_list.End();
+}
+
+void Layout::ScheduleItems(RenderState const& state)
+{
+    auto& sched = m_scheduler;
+    auto const& items = state.items;
+
+    // Scene items compare against these for their indicator and priority
+    OBSSourceAutoRelease program = obs_frontend_get_current_scene();
+    OBSSourceAutoRelease preview = obs_frontend_get_current_preview_scene();
+    sched.frame.program = program.Get();
+    sched.frame.preview = preview.Get();
+    sched.frame.studio_mode = obs_frontend_preview_program_mode_active();
+
+    sched.modes.assign(items.size(), LayoutItem::RENDER_FULL);
+    sched.deferred.clear();
+
+    int const budget_ms = m_render_budget_ms;
+    if (budget_ms <= 0) {
+        for (auto const& Entry : items)
+            Entry.item->SetRenderMode(LayoutItem::RENDER_FULL);
+        return;
+    }
+
+    sched.order.resize(items.size());
+    sched.priorities.resize(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        auto const& item = items[i].item;
+        auto priority = item->RenderPriority(items[i].data);
+        if (item->Hovered())
+            priority = qMin(priority, LayoutItem::PRIORITY_HOVERED);
+        sched.priorities[i] = priority;
+        sched.order[i] = i;
+    }
+    std::stable_sort(sched.order.begin(), sched.order.end(), [&sched](size_t a, size_t b) {
+        return sched.priorities[a] < sched.priorities[b];
+    });
+
+    // Costs are measured on the CPU, which only submits the work. With GPU
+    // timing enabled they are scaled by how much longer the GPU took
+    double const factor = m_gpu_timing ? sched.gpu.Factor() : 1.0;
+    double remaining = budget_ms * 1000000.0;
+    for (auto i : sched.order) {
+        auto const& item = items[i].item;
+        double const cost = item->m_render_cost_ns * factor;
+        if (sched.priorities[i] <= LayoutItem::PRIORITY_HOVERED || !item->CanRenderCached() || cost <= remaining) {
+            remaining -= cost;
+        } else {
+            sched.modes[i] = LayoutItem::RENDER_CACHED;
+            sched.deferred.push_back(i);
+        }
+    }
+
+    // One deferred cell is refreshed per frame, so none of them stays frozen
+    if (!sched.deferred.empty()) {
+        auto i = sched.deferred[sched.round_robin++ % sched.deferred.size()];
+        sched.modes[i] = LayoutItem::RENDER_REFRESH;
+    }
+
+    for (size_t i = 0; i < items.size(); i++)
+        items[i].item->SetRenderMode(sched.modes[i]);
+}
+
+void Layout::RenderThrottledOverlay(RenderState const& state)
+{
+    auto& sched = m_scheduler;
+    auto const& cfg = state.cfg;
+    int const throttled = int(sched.deferred.size());
+    int const total = int(state.items.size());
+
+    // Marks cells that currently show an older frame
+    for (auto i : sched.deferred) {
+        auto const& Entry = state.items[i];
+        LayoutItem::QueueBox(Entry.rel_left + cfg.border, Entry.rel_top + cfg.border, Entry.data.inner_width,
+            cfg.border + 2, COLOR_THROTTLED_AMBER, DrawList::LAYER_OVERLAY);
+    }
+
+    if (throttled == 0) {
+        sched.label.reset();
+        sched.shown_throttled = 0;
+        return;
+    }
+
+    if (!sched.label || throttled != sched.shown_throttled || total != sched.shown_total) {
+        auto text = QString(T_OVERLAY_THROTTLED).arg(throttled).arg(total);
+        sched.label = Labels::Get(qt_to_utf8(text), 16);
+        sched.shown_throttled = throttled;
+        sched.shown_total = total;
+    }
+
+    auto const& label = sched.label;
+    if (!label->Ready())
+        return;
+
+    // Constant size on screen, regardless of how much the multiview is scaled
+    gs_matrix_push();
+    gs_matrix_scale3f(1.0f / cfg.scale, 1.0f / cfg.scale, 1.0f);
+    LayoutItem::QueueBox(0, 0, label->Width() + 8, label->Height() + 4, COLOR_BLACK, DrawList::LAYER_LABEL);
+    gs_matrix_translate3f(4, 2, 0);
+    label->Draw(COLOR_THROTTLED_AMBER);
+    gs_matrix_pop();
 }
 
 void Layout::Resize(int target_cx, int target_cy, int cx, int cy)
 {
     // We calculate most layout values only on resize here
-    m_cfg.canvas_width = target_cx;
-    m_cfg.canvas_height = target_cy;
+    auto cfg = m_cfg;
+    cfg.canvas_width = target_cx;
+    cfg.canvas_height = target_cy;
 
     float ar = float(target_cx) / float(target_cy);
 
     // TODO: do height first and then calculate target_cx based on that?
-    m_cfg.cell_width = float(target_cx) / m_cols;
-    m_cfg.cell_height = m_cfg.cell_width / ar;
+    cfg.cell_width = float(target_cx) / m_cols;
+    cfg.cell_height = cfg.cell_width / ar;
 
-    target_cy = m_cfg.cell_height * m_rows;
+    target_cy = cfg.cell_height * m_rows;
 
-    m_cfg.cx = target_cx;
-    m_cfg.cy = target_cy;
+    cfg.cx = target_cx;
+    cfg.cy = target_cy;
 
-    GetScaleAndCenterPos(target_cx, target_cy, cx, cy, m_cfg.x, m_cfg.y, m_cfg.scale);
+    GetScaleAndCenterPos(target_cx, target_cy, cx, cy, cfg.x, cfg.y, cfg.scale);
+
+    // Resizing the window usually only moves/scales the multiview, which leaves the cells untouched
+    auto dirty = LayoutItem::GetDirtyFlags(m_cfg, cfg);
+    m_cfg = cfg;
+    if (dirty == LayoutItem::DIRTY_NONE)
+        return;
 
     m_layout_mutex.lock();
     for (auto& Item : m_layout_items)
-        Item->Update(m_cfg);
+        Item->Update(m_cfg, dirty);
+    PublishRenderState();
     m_layout_mutex.unlock();
 }
 
 void Layout::RefreshGrid()
 {
-    auto target_cx = m_cfg.canvas_width;
-    auto target_cy = m_cfg.canvas_height;
+    auto cfg = m_cfg;
+    auto target_cx = cfg.canvas_width;
+    auto target_cy = cfg.canvas_height;
 
     float ar = float(target_cx) / float(target_cy);
-    m_cfg.cell_width = float(m_cfg.canvas_width) / m_cols;
-    m_cfg.cell_height = m_cfg.cell_width / ar;
+    cfg.cell_width = float(cfg.canvas_width) / m_cols;
+    cfg.cell_height = cfg.cell_width / ar;
 
-    target_cy = m_cfg.cell_height * m_rows;
+    target_cy = cfg.cell_height * m_rows;
 
-    m_cfg.cx = target_cx;
-    m_cfg.cy = target_cy;
+    cfg.cx = target_cx;
+    cfg.cy = target_cy;
 
     auto* db = static_cast<Durchblick*>(parent());
     auto s = db->size() * db->devicePixelRatioF();
-    GetScaleAndCenterPos(target_cx, target_cy, s.width(), s.height(), m_cfg.x, m_cfg.y, m_cfg.scale);
+    GetScaleAndCenterPos(target_cx, target_cy, s.width(), s.height(), cfg.x, cfg.y, cfg.scale);
+
+    auto dirty = LayoutItem::GetDirtyFlags(m_cfg, cfg);
+    m_cfg = cfg;
 
     // Delete any cells that don't fit on the screen anymore
     m_layout_mutex.lock();
-    auto it = std::remove_if(m_layout_items.begin(), m_layout_items.end(), [this](std::unique_ptr<LayoutItem> const& item) {
+    auto it = std::remove_if(m_layout_items.begin(), m_layout_items.end(), [this](std::shared_ptr<LayoutItem> const& item) {
         return item->m_cell.right() >= m_cols + 1 || item->m_cell.bottom() >= m_rows + 1;
     });
     m_layout_items.erase(it, m_layout_items.end());
+    RebuildGrid();
     FillEmptyCells();
 
-    for (auto& Item : m_layout_items)
-        Item->Update(m_cfg);
+    // New placeholders already use the current config, everything else only needs what changed
+    if (dirty != LayoutItem::DIRTY_NONE) {
+        for (auto& Item : m_layout_items)
+            Item->Update(m_cfg, dirty);
+    }
+    PublishRenderState();
     m_layout_mutex.unlock();
 }
 
@@ -432,10 +721,11 @@ void Layout::CreateDefaultLayout()
     preview->SetLabel(true);
     preview->CreateLabel();
     preview->Update(m_cfg);
-    m_layout_items.emplace_back(preview);
-    m_layout_items.emplace_back(program);
     m_cols = 4;
     m_rows = 4;
+    RebuildGrid();
+    AddItem(preview);
+    AddItem(program);
 
     struct obs_frontend_source_list scenes = {};
 
@@ -444,15 +734,16 @@ void Layout::CreateDefaultLayout()
         if (i >= int(scenes.sources.num)) {
             auto* Item = new PlaceholderItem(this, i % 4, i > 3 ? 3 : 2);
             Item->Update(m_cfg);
-            m_layout_items.emplace_back(Item);
+            AddItem(Item);
         } else {
             auto* item = new SceneItem(this, i % 4, i > 3 ? 3 : 2);
             item->SetLabel(true);
             item->SetSource(scenes.sources.array[i]);
             item->Update(m_cfg);
-            m_layout_items.emplace_back(item);
+            AddItem(item);
         }
     }
+    PublishRenderState();
     m_layout_mutex.unlock();
     obs_frontend_source_list_free(&scenes);
 
@@ -473,13 +764,17 @@ void Layout::Load(QJsonObject const& obj)
     m_cols = obj["cols"].toInt(4);
     m_rows = obj["rows"].toInt(4);
     m_locked = obj["locked"].toBool(false);
+    m_render_budget_ms = qMax(0, obj["render_budget_ms"].toInt(0));
+    m_gpu_timing = obj["gpu_timing"].toBool(false);
     auto items = obj["items"].toArray();
+    RebuildGrid();
 
+    SourceIndex sources; // Resolves item sources for the duration of the load
     for (auto const& item : std::as_const(items)) {
         auto* new_item = Registry::MakeItem(this, item.toObject());
         if (new_item) {
             new_item->Update(m_cfg);
-            m_layout_items.emplace_back(new_item);
+            AddItem(new_item);
         } else {
             QJsonDocument doc;
             doc.setObject(item.toObject());
@@ -501,6 +796,8 @@ void Layout::Save(QJsonObject& obj)
     obj["cols"] = m_cols;
     obj["rows"] = m_rows;
     obj["locked"] = m_locked;
+    obj["render_budget_ms"] = m_render_budget_ms.load();
+    obj["gpu_timing"] = m_gpu_timing.load();
     for (auto const& Item : m_layout_items) {
         QJsonObject obj;
         Item->WriteToJson(obj);
@@ -513,17 +810,22 @@ void Layout::DeleteLayout()
 {
     m_layout_mutex.lock();
     m_layout_items.clear();
+    RebuildGrid();
+    PublishRenderState();
     m_layout_mutex.unlock();
 }
 
+void Layout::ReleaseResources()
+{
+    std::lock_guard<std::mutex> lock(m_layout_mutex);
+    for (auto& item : m_layout_items)
+        item->ReleaseResources();
+}
+
 void Layout::ResetHover()
 {
-    if (m_hovered_cell.col > -1) {
-        m_hovered_cell.col = -1;
-        m_hovered_cell.row = -1;
-        auto pos = m_durchblick->mapFromGlobal(QCursor::pos());
-        for (auto const& i : m_layout_items) {
-            i->IsMouseOver(pos.x(), pos.y());
-        }
-    }
+    // m_hovered_cell is kept because the quick actions of the context menu still need it
+    if (m_hovered_item)
+        m_hovered_item->MouseLeave();
+    m_hovered_item = nullptr;
 }
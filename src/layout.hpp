@@ -22,6 +22,9 @@
 #include "items/registry.hpp"
 #include "ui/layout_config_dialog.hpp"
 #include "ui/new_item_dialog.hpp"
+#include "util/draw_list.hpp"
+#include "util/gpu_timer.hpp"
+#include "util/labels.hpp"
 #include <QMouseEvent>
 #include <algorithm>
 #include <memory>
@@ -36,10 +39,14 @@ inline void StartRegion(int vX, int vY, int vCX, int vCY, float oL,
     gs_viewport_push();
     gs_set_viewport(vX, vY, vCX, vCY);
     gs_ortho(oL, oR, oT, oB, -100.0f, 100.0f);
+    if (auto* dl = DrawList::Current())
+        dl->PushRegion(vX, vY, vCX, vCY, oL, oR, oT, oB);
 }
 
 inline void EndRegion()
 {
+    if (auto* dl = DrawList::Current())
+        dl->PopRegion();
     gs_viewport_pop();
     gs_projection_pop();
 }
@@ -70,13 +77,51 @@ inline void GetScaleAndCenterPos(int baseCX, int baseCY, int windowCX,
 
 class Layout : public QObject {
     friend class LayoutConfigDialog;
+
+    // Immutable copy of everything the graphics thread needs to draw the layout.
+    // It is replaced as a whole whenever the layout changes on the UI thread,
+    // so rendering never has to wait for m_layout_mutex
+    struct RenderState {
+        struct Entry {
+            std::shared_ptr<LayoutItem> item;
+            int rel_left, rel_top, width, height;
+            LayoutItem::RenderData data; // Source and inner size the item is drawn with
+        };
+        DurchblickItemConfig cfg;
+        std::vector<Entry> items;
+        bool dragging {};
+        int sel_x {}, sel_y {}, sel_cx {}, sel_cy {};
+    };
+
     int m_cols { 4 }, m_rows { 4 };
-    std::vector<std::unique_ptr<LayoutItem>> m_layout_items;
+    std::vector<std::shared_ptr<LayoutItem>> m_layout_items;
+    std::shared_ptr<RenderState const> m_render_state;
+    DrawList m_draw_list; // Only used by the graphics thread
+    // Occupancy grid, maps every cell (row major) to the item that covers it
+    std::vector<LayoutItem*> m_grid;
     DurchblickItemConfig m_cfg;
     Durchblick* m_durchblick {};
     LayoutItem::Cell m_hovered_cell {}, m_selection_start {}, m_selection_end {};
+    LayoutItem *m_hovered_item {}, *m_captured_item {}; // Mouse event targets
     bool m_dragging {}, m_locked {};
     std::mutex m_layout_mutex;
+
+    // Time the items of one frame may take in ms, cells above it are drawn
+    // from their cache in priority order. 0 (the default) renders everything every frame
+    std::atomic<int> m_render_budget_ms {};
+    std::atomic<bool> m_gpu_timing {}; // Also account for GPU time, if the driver supports timer queries
+
+    // Per frame bookkeeping of the budget, only used by the graphics thread
+    struct Scheduler {
+        std::vector<size_t> order, deferred;
+        std::vector<LayoutItem::Priority> priorities;
+        std::vector<LayoutItem::RenderMode> modes;
+        size_t round_robin {};
+        GpuTimer gpu;
+        int shown_throttled {}, shown_total {};
+        std::shared_ptr<Labels::Label> label;
+        LayoutItem::FrameData frame; // What RenderData::frame of every item points to
+    } m_scheduler;
     Q_OBJECT
 
     void GetSelection(int& tx, int& ty, int& cx, int& cy)
@@ -88,6 +133,25 @@ class Layout : public QObject {
     }
 
     void FillEmptyCells();
+    void ScheduleItems(RenderState const& state);
+    void RenderThrottledOverlay(RenderState const& state);
+    void PublishRenderState();
+    void PublishSelection();
+    void AddItem(LayoutItem* item);
+    void MarkCells(LayoutItem::Cell const& c, LayoutItem* owner);
+    void UnmarkCells(LayoutItem* item);
+    void RebuildGrid();
+
+    LayoutItem* ItemAtPos(int x, int y) const;
+    void RouteMouseEvent(LayoutItem::MouseData const& d);
+    void ReleaseCapture();
+
+    LayoutItem* ItemAt(int col, int row) const
+    {
+        if (col < 0 || row < 0 || col >= m_cols || row >= m_rows || m_grid.size() != size_t(m_cols * m_rows))
+            return nullptr;
+        return m_grid[row * m_cols + col];
+    }
 
     LayoutItem::Cell GetSelectedArea();
 private slots:
@@ -122,7 +186,7 @@ public:
     void FreeSpace(LayoutItem::Cell const& c);
     void AddWidget(Registry::ItemRegistry::Entry const& entry, LayoutItem::Cell const& c, QWidget* custom_widget);
     void AddWidget(Registry::ItemRegistry::Entry const& entry, QWidget* custom_widget);
-    void SetRegion(float bx, float by, float cx, float cy);
+    void SetRegion(DurchblickItemConfig const& cfg, float bx, float by, float cx, float cy);
     void Render(int target_cx, int target_cy, uint32_t cx, uint32_t cy);
     void Resize(int target_cx, int target_cy, int cx, int cy);
     void RefreshGrid();
@@ -133,14 +197,28 @@ public:
     bool IsEmpty() const { return m_layout_items.empty() || m_cols <= 0 || m_rows <= 0; }
     bool IsLocked() const { return m_locked; }
     void DeleteLayout();
+    /// Frees labels, volmeters etc. of all items, they are recreated once the layout is drawn again
+    void ReleaseResources();
     void ResetHover();
+    /// Publishes the items again after one of them changed what it draws, UI thread only
+    void RefreshRenderState()
+    {
+        std::lock_guard<std::mutex> lock(m_layout_mutex);
+        PublishRenderState();
+    }
     void Clear()
     {
         std::lock_guard<std::mutex> lock(m_layout_mutex);
         m_layout_items.clear();
+        RebuildGrid();
+        PublishRenderState();
     }
 
     int Columns() const { return m_cols; }
     int Rows() const { return m_rows; }
     DurchblickItemConfig const& Config() const { return m_cfg; }
+    int RenderBudget() const { return m_render_budget_ms; }
+    void SetRenderBudget(int ms) { m_render_budget_ms = qMax(0, ms); }
+    bool GpuTiming() const { return m_gpu_timing; }
+    void SetGpuTiming(bool b) { m_gpu_timing = b; }
 };
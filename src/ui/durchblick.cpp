@@ -193,6 +193,12 @@ void Durchblick::mouseDoubleClickEvent(QMouseEvent* e)
     m_layout.MouseDoubleClicked(e);
 }
 
+void Durchblick::leaveEvent(QEvent* e)
+{
+    QWidget::leaveEvent(e);
+    m_layout.ResetHover();
+}
+
 void Durchblick::contextMenuEvent(QContextMenuEvent*)
 {
 }
@@ -201,7 +207,7 @@ void Durchblick::closeEvent(QCloseEvent* e)
 {
     e->accept();
     OnClose();
-    Config::Save();
+    Config::SaveNow(); // The layout is deleted right after
     m_layout.DeleteLayout();
     hide();
     DeleteDisplay();
@@ -210,12 +216,22 @@ void Durchblick::closeEvent(QCloseEvent* e)
 void Durchblick::showEvent(QShowEvent* e)
 {
     QWidget::showEvent(e);
+    m_release_timer.stop();
     if (m_saved_state == WindowState::Maximized)
         setWindowState(windowState() | Qt::WindowMaximized);
     else if (m_current_monitor >= 0)
         SetMonitor(m_current_monitor);
 }
 
+void Durchblick::hideEvent(QHideEvent* e)
+{
+    QWidget::hideEvent(e);
+    // Hiding the dock or minimizing the window keeps the layout, so showing
+    // it again is instant. Its resources are only freed if it stays hidden
+    if (m_release_delay > 0)
+        m_release_timer.start(m_release_delay * 1000);
+}
+
 Durchblick::Durchblick(QWidget* widget, Qt::WindowType t)
     : OBSQTDisplay(widget, t)
     , m_layout(this)
@@ -250,6 +266,12 @@ Durchblick::Durchblick(QWidget* widget, Qt::WindowType t)
         &Durchblick::ScreenRemoved);
     connect(this, &OBSQTDisplay::DisplayResized, this, &Durchblick::Resize);
 
+    m_release_timer.setSingleShot(true);
+    connect(&m_release_timer, &QTimer::timeout, this, [this] {
+        if (!isVisible())
+            m_layout.ReleaseResources();
+    });
+
     m_ready = true;
     show();
 
@@ -331,6 +353,7 @@ void Durchblick::Save(QJsonObject& obj)
         obj["hide_from_display_capture"] = GetHideFromDisplayCapture();
         obj["hide_cursor"] = m_hide_cursor;
         obj["always_on_top"] = m_always_on_top;
+        obj["release_delay"] = m_release_delay;
         m_layout.Save(obj);
         m_cached_layout = obj;
     } else {
@@ -371,6 +394,7 @@ void Durchblick::Load(QJsonObject const& obj)
         SetMonitor(obj["monitor"].toInt(-1));
 
     SetHideCursor(obj["hide_cursor"].toBool(false));
+    SetReleaseDelay(obj["release_delay"].toInt(30));
     SetWidgetVisibility(obj["visible"].toBool(false));
 
     SetIsAlwaysOnTop(obj["always_on_top"].toBool(false), false);
@@ -43,6 +43,9 @@ class Durchblick : public OBSQTDisplay {
     bool m_hide_cursor { false };
     bool m_always_on_top { false };
 
+    int m_release_delay { 30 }; // Seconds until a hidden layout frees its labels, volmeters etc., 0 never does
+    QTimer m_release_timer;
+
     QJsonObject m_cached_layout {};
 
 public:
@@ -67,10 +70,12 @@ protected:
     virtual void mousePressEvent(QMouseEvent*) override;
     virtual void mouseReleaseEvent(QMouseEvent*) override;
     virtual void mouseDoubleClickEvent(QMouseEvent*) override;
+    virtual void leaveEvent(QEvent*) override;
     virtual void contextMenuEvent(QContextMenuEvent*) override;
 
     virtual void closeEvent(QCloseEvent*) override;
     virtual void showEvent(QShowEvent*) override;
+    virtual void hideEvent(QHideEvent*) override;
 
 protected:
     //    void dragEnterEvent(QDragEnterEvent *event) override;
@@ -113,6 +118,9 @@ public:
     }
 
     bool GetIsCursorHidden() const { return m_hide_cursor; }
+
+    void SetReleaseDelay(int seconds) { m_release_delay = qMax(0, seconds); }
+    int GetReleaseDelay() const { return m_release_delay; }
     bool HasSize() const { return m_has_size; }
 
     Layout* GetLayout() { return &m_layout; }
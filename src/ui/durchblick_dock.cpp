@@ -8,7 +8,7 @@ void DurchblickDock::closeEvent(QCloseEvent* e)
 {
     e->accept();
     db->OnClose();
-    Config::Save();
+    Config::SaveNow(); // The layout is deleted right after
     db->GetLayout()->DeleteLayout();
     db->DeleteDisplay();
     hide();
@@ -18,13 +18,17 @@ void DurchblickDock::showEvent(QShowEvent* e)
 {
     QWidget::showEvent(e);
     if (!e->spontaneous()) {
-        auto layouts = Config::LoadLayoutsForCurrentSceneCollection();
-        db->GetLayout()->DeleteLayout();
         db->CreateDisplay(true);
-        if (layouts.size() > 1) {
-            db->Load(layouts[1].toObject());
-        } else {
-            db->GetLayout()->CreateDefaultLayout();
+
+        // The layout stays alive while the dock is hidden, it only has to be
+        // loaded again if the dock was closed
+        if (db->GetLayout()->IsEmpty()) {
+            auto layouts = Config::LoadLayoutsForCurrentSceneCollection();
+            if (layouts.size() > 1) {
+                db->Load(layouts[1].toObject());
+            } else {
+                db->GetLayout()->CreateDefaultLayout();
+            }
         }
         // Forces a grid refresh
         // just refreshing the grid doesn't seem to work
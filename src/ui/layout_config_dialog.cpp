@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #include "layout_config_dialog.hpp"
+#include "../config.hpp"
 #include "../layout.hpp"
 #include "../util/util.h"
 #include "durchblick.hpp"
@@ -27,6 +28,8 @@ void LayoutConfigDialog::OKClicked()
 {
     m_layout->m_cols = m_cols->value();
     m_layout->m_rows = m_rows->value();
+    m_layout->SetRenderBudget(m_render_budget->value());
+    m_layout->SetGpuTiming(m_gpu_timing->isChecked());
     m_layout->RefreshGrid();
 
 #if defined(_WIN32)
@@ -34,6 +37,8 @@ void LayoutConfigDialog::OKClicked()
 #endif
 
     m_durchblick->SetHideCursor(m_hide_cursor->isChecked());
+    m_durchblick->SetReleaseDelay(m_release_delay->value());
+    Config::SetBinaryStorage(m_binary_storage->isChecked());
     hide();
 }
 
@@ -78,6 +83,36 @@ LayoutConfigDialog::LayoutConfigDialog(Durchblick* parent, Layout* layout)
     m_hide_cursor->setChecked(m_durchblick->GetIsCursorHidden());
     m_vboxlayout->addWidget(m_hide_cursor);
 
+    auto* release_layout = new QHBoxLayout();
+    release_layout->addWidget(new QLabel(T_LABEL_RELEASE_DELAY, this));
+    m_release_delay = new QSpinBox(this);
+    m_release_delay->setRange(0, 3600);
+    m_release_delay->setSuffix(" s");
+    m_release_delay->setSpecialValueText(T_LABEL_NEVER);
+    m_release_delay->setValue(m_durchblick->GetReleaseDelay());
+    release_layout->addWidget(m_release_delay);
+    release_layout->setContentsMargins(0, 0, 0, 0);
+    m_vboxlayout->addLayout(release_layout);
+
+    auto* budget_layout = new QHBoxLayout();
+    budget_layout->addWidget(new QLabel(T_LABEL_RENDER_BUDGET, this));
+    m_render_budget = new QSpinBox(this);
+    m_render_budget->setRange(0, 50);
+    m_render_budget->setSuffix(" ms");
+    m_render_budget->setSpecialValueText(T_LABEL_UNLIMITED);
+    m_render_budget->setValue(layout->RenderBudget());
+    budget_layout->addWidget(m_render_budget);
+    budget_layout->setContentsMargins(0, 0, 0, 0);
+    m_vboxlayout->addLayout(budget_layout);
+
+    m_gpu_timing = new QCheckBox(T_LABEL_GPU_TIMING, this);
+    m_gpu_timing->setChecked(layout->GpuTiming());
+    m_vboxlayout->addWidget(m_gpu_timing);
+
+    m_binary_storage = new QCheckBox(T_LABEL_BINARY_STORAGE, this);
+    m_binary_storage->setChecked(Config::GetBinaryStorage());
+    m_vboxlayout->addWidget(m_binary_storage);
+
     m_button_box = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
     m_vboxlayout->addWidget(m_button_box);
     setLayout(m_vboxlayout);
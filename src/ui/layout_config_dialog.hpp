@@ -33,8 +33,8 @@ class LayoutConfigDialog : public QDialog {
     Q_OBJECT
     QVBoxLayout* m_vboxlayout {};
     QDialogButtonBox* m_button_box {};
-    QSpinBox *m_cols {}, *m_rows {};
-    QCheckBox *m_hide_from_display_capture {}, *m_hide_cursor {};
+    QSpinBox *m_cols {}, *m_rows {}, *m_release_delay {}, *m_render_budget {};
+    QCheckBox *m_hide_from_display_capture {}, *m_hide_cursor {}, *m_binary_storage {}, *m_gpu_timing {};
     Layout* m_layout {};
     Durchblick* m_durchblick {};
 private slots:
@@ -77,7 +77,9 @@ typedef const char* (*DurchblickItemNameCb)();
 typedef void (*DurchblickItemDestroyCb)(void* item, void* data);
 
 /**
- * Callback when the widget needs to be updated. Usually happens on window resize
+ * Callback when the widget needs to be updated. Only happens when the size of the
+ * cells changed, moving or scaling the whole multiview inside the window does not
+ * trigger an update. The current config is passed to every render call.
  * @param item      The layout item object
  * @param data      Private user data
  * @param cfg       New widget config data
@@ -119,7 +121,8 @@ typedef void (*DurchblickItemLoadCb)(void* item, void* data, json_t* result);
 typedef void (*DurchblickItemRenderCb)(void* item, void* data, struct DurchblickItemConfig const* cfg);
 
 /**
- * Mouse event callback
+ * Mouse event callback, only called while the mouse is over the item or
+ * while the item holds the mouse capture after a button was pressed on it
  * @param item      The layout item object
  * @param data      Private user data
  * @param cfg       The widget config
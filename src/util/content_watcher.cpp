@@ -0,0 +1,209 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "content_watcher.hpp"
+#include <algorithm>
+#include <util/platform.h>
+
+// The downscaled copy is halved until it fits into this size, a few KB to read back
+static constexpr uint32_t ProbeSize = 64;
+// Probe intervals, changing content is probed at the start interval and
+// content that didn't change at one that doubles up to the maximum
+static constexpr uint64_t StartInterval = 50000000ULL;
+static constexpr uint64_t MaxInterval = 500000000ULL;
+
+static char const* SourceSignals[] = {
+    "update",
+    "filter_add",
+    "filter_remove",
+    "reorder_filters",
+    "media_play",
+    "media_pause",
+    "media_restart",
+    "media_stopped",
+    "media_started",
+    "media_ended",
+    "media_next",
+    "media_previous",
+};
+
+static char const* SceneSignals[] = {
+    "item_add",
+    "item_remove",
+    "item_visible",
+    "item_transform",
+    "reorder",
+    "refresh",
+};
+
+ContentWatcher::~ContentWatcher()
+{
+    Free();
+}
+
+void ContentWatcher::SourceChanged(void* data, calldata_t*)
+{
+    static_cast<ContentWatcher*>(data)->m_dirty = true;
+}
+
+void ContentWatcher::Watch(obs_source_t* src)
+{
+    m_signals.clear();
+    m_dirty = true;
+    if (!src)
+        return;
+
+    auto* handler = obs_source_get_signal_handler(src);
+    for (auto* name : SourceSignals)
+        m_signals.emplace_back(handler, name, SourceChanged, this);
+    if (obs_scene_from_source(src)) {
+        for (auto* name : SceneSignals)
+            m_signals.emplace_back(handler, name, SourceChanged, this);
+    }
+}
+
+void ContentWatcher::Free()
+{
+    if (!m_stage && m_levels.empty())
+        return;
+
+    // Reset before leaving the graphics context, so no frame can see dangling handles
+    obs_enter_graphics();
+    for (auto* texrender : m_levels)
+        gs_texrender_destroy(texrender);
+    if (m_stage)
+        gs_stagesurface_destroy(m_stage);
+    m_levels.clear();
+    m_stage = nullptr;
+    m_staged = false;
+    m_has_checksum = false;
+    obs_leave_graphics();
+    m_dirty = true;
+}
+
+ContentWatcher::State ContentWatcher::Check(obs_source_t* src)
+{
+    // Probes until Rendered() is called, in case the cell skips a frame
+    if (m_dirty.exchange(false)) {
+        m_interval = 0;
+        m_next_check = 0;
+    }
+
+    if (obs_source_get_output_flags(src) & OBS_SOURCE_CONTROLLABLE_MEDIA) {
+        switch (obs_source_media_get_state(src)) {
+        case OBS_MEDIA_STATE_PLAYING:
+        case OBS_MEDIA_STATE_OPENING:
+        case OBS_MEDIA_STATE_BUFFERING:
+            return State::Changing;
+        default:
+            break;
+        }
+    }
+    if (os_gettime_ns() >= m_next_check)
+        return State::Probe;
+    return m_live ? State::Changing : State::Static;
+}
+
+gs_texture_t* ContentWatcher::Downscale(gs_texture_t* tex, uint32_t& cx, uint32_t& cy)
+{
+    gs_effect_t* effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+    gs_eparam_t* image = gs_effect_get_param_by_name(effect, "image");
+
+    // Halving with linear filtering averages 2x2 texels each time, so unlike
+    // a single downscale every pixel of the source ends up in the checksum
+    gs_blend_state_push();
+    gs_enable_blending(false);
+    for (size_t level = 0; tex && (cx > ProbeSize || cy > ProbeSize); level++) {
+        cx = std::max(cx / 2, 1u);
+        cy = std::max(cy / 2, 1u);
+
+        if (level == m_levels.size())
+            m_levels.push_back(gs_texrender_create(GS_RGBA, GS_ZS_NONE));
+        auto* texrender = m_levels[level];
+        if (texrender)
+            gs_texrender_reset(texrender);
+        if (!texrender || !gs_texrender_begin(texrender, cx, cy)) {
+            tex = nullptr;
+            break;
+        }
+
+        gs_ortho(0.0f, float(cx), 0.0f, float(cy), -100.0f, 100.0f);
+        gs_effect_set_texture(image, tex);
+        while (gs_effect_loop(effect, "Draw"))
+            gs_draw_sprite(tex, 0, cx, cy);
+        gs_texrender_end(texrender);
+        tex = gs_texrender_get_texture(texrender);
+    }
+    gs_blend_state_pop();
+    return tex;
+}
+
+bool ContentWatcher::ReadChecksum(uint64_t& checksum)
+{
+    uint8_t* data {};
+    uint32_t linesize {};
+    m_staged = false;
+    if (!gs_stagesurface_map(m_stage, &data, &linesize))
+        return false;
+
+    // FNV-1a
+    checksum = 14695981039346656037ULL;
+    for (uint32_t y = 0; y < m_stage_cy; y++) {
+        auto const* row = data + size_t(y) * linesize;
+        for (uint32_t x = 0; x < m_stage_cx * 4; x++) {
+            checksum ^= row[x];
+            checksum *= 1099511628211ULL;
+        }
+    }
+    gs_stagesurface_unmap(m_stage);
+    return true;
+}
+
+void ContentWatcher::Rendered(gs_texture_t* tex, uint32_t cx, uint32_t cy)
+{
+    // The copy staged last time is read now, so waiting for the GPU never stalls the frame
+    uint64_t checksum {};
+    if (m_staged && ReadChecksum(checksum)) {
+        bool const same = m_has_checksum && checksum == m_checksum;
+        if (same)
+            m_interval = m_interval ? std::min(m_interval * 2, MaxInterval) : StartInterval;
+        else
+            m_interval = StartInterval;
+        m_live = !same;
+        m_checksum = checksum;
+        m_has_checksum = true;
+    }
+    m_next_check = os_gettime_ns() + m_interval;
+
+    tex = Downscale(tex, cx, cy);
+    if (!tex)
+        return;
+
+    if (!m_stage || cx != m_stage_cx || cy != m_stage_cy) {
+        if (m_stage)
+            gs_stagesurface_destroy(m_stage);
+        m_stage = gs_stagesurface_create(cx, cy, GS_RGBA);
+        m_stage_cx = cx;
+        m_stage_cy = cy;
+    }
+    if (!m_stage)
+        return;
+
+    gs_stage_texture(m_stage, tex);
+    m_staged = true;
+}
@@ -0,0 +1,75 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <obs.hpp>
+#include <vector>
+
+/* Tells whether a source might look different than when it was last rendered
+ * into a cached texture, so cells showing static content can keep drawing
+ * that texture. Signals of the source (settings, filters, media state, scene
+ * items) mark it as changed right away. Since sync sources have no signal for
+ * new frames, they are probed: rendered into the cache and compared with a
+ * small downscaled copy of the previous probe. Static content is probed at an
+ * interval that grows while nothing changes, changing content is rendered
+ * directly and only probed every StartInterval. Playing media is never probed.
+ */
+class ContentWatcher {
+public:
+    enum class State {
+        Static,   // Draw the cached texture
+        Changing, // Render the source as usual
+        Probe,    // Render into the cached texture and call Rendered()
+    };
+
+private:
+    std::vector<OBSSignal> m_signals;
+    std::atomic<bool> m_dirty { true };
+
+    // Graphics thread only
+    std::vector<gs_texrender_t*> m_levels; // Downscale chain, each half the size of the previous one
+    gs_stagesurf_t* m_stage {};
+    uint32_t m_stage_cx {}, m_stage_cy {};
+    bool m_staged {}, m_has_checksum {};
+    bool m_live { true }; // Whether the last probes differed
+    uint64_t m_checksum {}, m_interval {}, m_next_check {};
+
+    static void SourceChanged(void* data, calldata_t*);
+    gs_texture_t* Downscale(gs_texture_t* tex, uint32_t& cx, uint32_t& cy);
+    bool ReadChecksum(uint64_t& checksum);
+
+public:
+    ContentWatcher() = default;
+    ~ContentWatcher();
+    ContentWatcher(ContentWatcher const&) = delete;
+    ContentWatcher& operator=(ContentWatcher const&) = delete;
+
+    /// Connects to the signals of the source, UI thread only
+    void Watch(obs_source_t* src);
+    /// Renders the source again on the next frame, from any thread
+    void Invalidate() { m_dirty = true; }
+
+    /// How the source should be drawn this frame. Graphics thread only
+    State Check(obs_source_t* src);
+    /// Call after a probe rendered the source into tex, to compare it with the previous one
+    void Rendered(gs_texture_t* tex, uint32_t cx, uint32_t cy);
+
+    /// Frees the textures, only call while nothing is rendered
+    void Free();
+};
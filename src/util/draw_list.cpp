@@ -0,0 +1,310 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+#include "draw_list.hpp"
+#include "labels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <graphics/matrix4.h>
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+
+DrawList* DrawList::s_current = nullptr;
+
+DrawList::~DrawList()
+{
+    if (s_current == this)
+        s_current = nullptr;
+    if (m_vb || m_text_vb) {
+        obs_enter_graphics();
+        gs_vertexbuffer_destroy(m_vb);
+        gs_vertexbuffer_destroy(m_text_vb);
+        obs_leave_graphics();
+    }
+}
+
+void DrawList::Begin(uint32_t cx, uint32_t cy)
+{
+    m_cx = cx;
+    m_cy = cy;
+    m_regions.clear();
+    for (auto& layer : m_layers)
+        layer.clear();
+    m_text.clear();
+    s_current = this;
+}
+
+void DrawList::End()
+{
+    Flush(LAYER_LABEL);
+    FlushText();
+    Flush();
+    if (s_current == this)
+        s_current = nullptr;
+}
+
+void DrawList::PushRegion(float vx, float vy, float vcx, float vcy, float left, float right, float top, float bottom)
+{
+    m_regions.push_back({ vx, vy, vcx, vcy, left, right, top, bottom });
+}
+
+void DrawList::PopRegion()
+{
+    if (!m_regions.empty())
+        m_regions.pop_back();
+}
+
+void DrawList::AddQuad(float x, float y, float cx, float cy, uint32_t argb, Layer layer)
+{
+    if (!(cx > 0 && cy > 0))
+        return;
+
+    matrix4 m;
+    vec3 a, b;
+    gs_matrix_get(&m);
+    vec3_set(&a, x, y, 0);
+    vec3_set(&b, x + cx, y + cy, 0);
+    vec3_transform(&a, &a, &m);
+    vec3_transform(&b, &b, &m);
+
+    float x0 = std::min(a.x, b.x), x1 = std::max(a.x, b.x);
+    float y0 = std::min(a.y, b.y), y1 = std::max(a.y, b.y);
+
+    // Map from the region projection into window space and clip
+    // to the region viewport like the GPU would
+    if (!m_regions.empty()) {
+        auto const& r = m_regions.back();
+        if (r.right == r.left || r.bottom == r.top)
+            return;
+        float sx = r.vcx / (r.right - r.left);
+        float sy = r.vcy / (r.bottom - r.top);
+        x0 = std::max(r.vx + (x0 - r.left) * sx, r.vx);
+        x1 = std::min(r.vx + (x1 - r.left) * sx, r.vx + r.vcx);
+        y0 = std::max(r.vy + (y0 - r.top) * sy, r.vy);
+        y1 = std::min(r.vy + (y1 - r.top) * sy, r.vy + r.vcy);
+    }
+
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    // Vertex colors are RGBA in memory, so red and blue have to be swapped
+    uint32_t abgr = (argb & 0xFF00FF00) | ((argb & 0xFF) << 16) | ((argb >> 16) & 0xFF);
+    auto& v = m_layers[layer];
+    v.push_back({ x0, y0, abgr });
+    v.push_back({ x1, y0, abgr });
+    v.push_back({ x0, y1, abgr });
+    v.push_back({ x1, y0, abgr });
+    v.push_back({ x1, y1, abgr });
+    v.push_back({ x0, y1, abgr });
+}
+
+void DrawList::AddGlyph(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, uint32_t argb)
+{
+    matrix4 m;
+    vec3 a, b, c;
+    gs_matrix_get(&m);
+    vec3_set(&a, x0, y0, 0);
+    vec3_set(&b, x1, y0, 0);
+    vec3_set(&c, x0, y1, 0);
+    vec3_transform(&a, &a, &m);
+    vec3_transform(&b, &b, &m);
+    vec3_transform(&c, &c, &m);
+
+    float clip_x0 = 0, clip_y0 = 0, clip_x1 = float(m_cx), clip_y1 = float(m_cy);
+    if (!m_regions.empty()) {
+        auto const& r = m_regions.back();
+        if (r.right == r.left || r.bottom == r.top)
+            return;
+        float sx = r.vcx / (r.right - r.left);
+        float sy = r.vcy / (r.bottom - r.top);
+        for (auto* p : { &a, &b, &c }) {
+            p->x = r.vx + (p->x - r.left) * sx;
+            p->y = r.vy + (p->y - r.top) * sy;
+        }
+        clip_x0 = r.vx;
+        clip_y0 = r.vy;
+        clip_x1 = r.vx + r.vcx;
+        clip_y1 = r.vy + r.vcy;
+    }
+
+    // Edges of the quad in window space, s runs along the text and t across it
+    float e1x = b.x - a.x, e1y = b.y - a.y;
+    float e2x = c.x - a.x, e2y = c.y - a.y;
+    float s0 = 0, s1 = 1, t0 = 0, t1 = 1;
+
+    // Labels are only scaled or rotated by multiples of 90 degrees, then every
+    // edge is parallel to a window axis and the quad can be clipped to the
+    // region in its own coordinates. Anything else is drawn unclipped
+    auto parallel = [](float along, float across) { return std::fabs(across) <= std::fabs(along) * 1e-4f; };
+    bool aligned = (parallel(e1x, e1y) && parallel(e2y, e2x)) || (parallel(e1y, e1x) && parallel(e2x, e2y));
+    if (aligned) {
+        auto clip = [](float& lo, float& hi, float origin, float edge, float min, float max) {
+            if (std::fabs(edge) < 1e-6f)
+                return;
+            float from = (min - origin) / edge, to = (max - origin) / edge;
+            if (from > to)
+                std::swap(from, to);
+            lo = std::max(lo, from);
+            hi = std::min(hi, to);
+        };
+        bool horizontal = parallel(e1x, e1y);
+        clip(s0, s1, horizontal ? a.x : a.y, horizontal ? e1x : e1y, horizontal ? clip_x0 : clip_y0, horizontal ? clip_x1 : clip_y1);
+        clip(t0, t1, horizontal ? a.y : a.x, horizontal ? e2y : e2x, horizontal ? clip_y0 : clip_x0, horizontal ? clip_y1 : clip_x1);
+        if (s1 <= s0 || t1 <= t0)
+            return;
+    }
+
+    uint32_t abgr = (argb & 0xFF00FF00) | ((argb & 0xFF) << 16) | ((argb >> 16) & 0xFF);
+    auto vertex = [&](float s, float t) -> TextVertex {
+        return { a.x + s * e1x + t * e2x, a.y + s * e1y + t * e2y, u0 + s * (u1 - u0), v0 + t * (v1 - v0), abgr };
+    };
+    m_text.push_back(vertex(s0, t0));
+    m_text.push_back(vertex(s1, t0));
+    m_text.push_back(vertex(s0, t1));
+    m_text.push_back(vertex(s1, t0));
+    m_text.push_back(vertex(s1, t1));
+    m_text.push_back(vertex(s0, t1));
+}
+
+void DrawList::Flush(Layer last)
+{
+    size_t count = 0;
+    for (int i = 0; i <= last; i++)
+        count += m_layers[i].size();
+
+    if (count > 0)
+        Draw(count, last);
+
+    for (int i = 0; i <= last; i++)
+        m_layers[i].clear();
+}
+
+void DrawList::Draw(size_t vertex_count, int last_layer)
+{
+    if (!m_vb || vertex_count > m_vb_capacity) {
+        if (m_vb)
+            gs_vertexbuffer_destroy(m_vb);
+        m_vb_capacity = std::max(vertex_count, m_vb_capacity * 2);
+        auto* vbd = gs_vbdata_create();
+        vbd->num = m_vb_capacity;
+        vbd->points = (vec3*)bzalloc(sizeof(vec3) * m_vb_capacity);
+        vbd->colors = (uint32_t*)bzalloc(sizeof(uint32_t) * m_vb_capacity);
+        m_vb = gs_vertexbuffer_create(vbd, GS_DYNAMIC);
+        if (!m_vb) {
+            m_vb_capacity = 0;
+            return;
+        }
+    }
+
+    auto* data = gs_vertexbuffer_get_data(m_vb);
+    size_t n = 0;
+    for (int i = 0; i <= last_layer; i++) {
+        for (auto const& v : m_layers[i]) {
+            vec3_set(&data->points[n], v.x, v.y, 0);
+            data->colors[n] = v.color;
+            n++;
+        }
+    }
+    data->num = n;
+    gs_vertexbuffer_flush(m_vb);
+
+    PushWindowSpace();
+    gs_effect_t* solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+    gs_eparam_t* color = gs_effect_get_param_by_name(solid, "color");
+    gs_effect_set_color(color, 0xFFFFFFFF);
+
+    gs_load_vertexbuffer(m_vb);
+    gs_load_indexbuffer(nullptr);
+    while (gs_effect_loop(solid, "SolidColored"))
+        gs_draw(GS_TRIS, 0, uint32_t(n));
+    gs_load_vertexbuffer(nullptr);
+    PopWindowSpace();
+    data->num = m_vb_capacity;
+}
+
+void DrawList::FlushText()
+{
+    if (!m_text.empty())
+        DrawGlyphs();
+    m_text.clear();
+}
+
+void DrawList::DrawGlyphs()
+{
+    gs_effect_t* effect = Labels::Effect();
+    gs_texture_t* atlas = Labels::UpdateAtlas();
+    if (!effect || !atlas)
+        return;
+
+    size_t const count = m_text.size();
+    if (!m_text_vb || count > m_text_vb_capacity) {
+        if (m_text_vb)
+            gs_vertexbuffer_destroy(m_text_vb);
+        m_text_vb_capacity = std::max(count, m_text_vb_capacity * 2);
+        auto* vbd = gs_vbdata_create();
+        vbd->num = m_text_vb_capacity;
+        vbd->points = (vec3*)bzalloc(sizeof(vec3) * m_text_vb_capacity);
+        vbd->colors = (uint32_t*)bzalloc(sizeof(uint32_t) * m_text_vb_capacity);
+        vbd->num_tex = 1;
+        vbd->tvarray = (gs_tvertarray*)bzalloc(sizeof(gs_tvertarray));
+        vbd->tvarray[0].width = 2;
+        vbd->tvarray[0].array = bzalloc(sizeof(vec2) * m_text_vb_capacity);
+        m_text_vb = gs_vertexbuffer_create(vbd, GS_DYNAMIC);
+        if (!m_text_vb) {
+            m_text_vb_capacity = 0;
+            return;
+        }
+    }
+
+    auto* data = gs_vertexbuffer_get_data(m_text_vb);
+    auto* uv = static_cast<vec2*>(data->tvarray[0].array);
+    for (size_t i = 0; i < count; i++) {
+        auto const& v = m_text[i];
+        vec3_set(&data->points[i], v.x, v.y, 0);
+        vec2_set(&uv[i], v.u, v.v);
+        data->colors[i] = v.color;
+    }
+    data->num = count;
+    gs_vertexbuffer_flush(m_text_vb);
+
+    PushWindowSpace();
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "atlas"), atlas);
+    gs_load_vertexbuffer(m_text_vb);
+    gs_load_indexbuffer(nullptr);
+    while (gs_effect_loop(effect, "Draw"))
+        gs_draw(GS_TRIS, 0, uint32_t(count));
+    gs_load_vertexbuffer(nullptr);
+    PopWindowSpace();
+    data->num = m_text_vb_capacity;
+}
+
+void DrawList::PushWindowSpace()
+{
+    gs_viewport_push();
+    gs_projection_push();
+    gs_matrix_push();
+    gs_set_viewport(0, 0, m_cx, m_cy);
+    gs_ortho(0.0f, float(m_cx), 0.0f, float(m_cy), -100.0f, 100.0f);
+    gs_matrix_identity();
+}
+
+void DrawList::PopWindowSpace()
+{
+    gs_matrix_pop();
+    gs_projection_pop();
+    gs_viewport_pop();
+}
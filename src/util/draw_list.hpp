@@ -0,0 +1,95 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+#pragma once
+#include <cstdint>
+#include <obs-module.h>
+#include <vector>
+
+/* Collects solid colored quads of one frame and draws them with as few draw
+ * calls as possible. Quads are transformed into window space when they are added,
+ * so they can be flushed later regardless of the current region/matrix.
+ * Only ever used from the graphics thread.
+ */
+class DrawList {
+public:
+    enum Layer {
+        LAYER_BORDER,  // Cell borders and backgrounds, drawn before any item content
+        LAYER_CONTENT, // Meters, indicators etc. drawn on top of item content
+        LAYER_LABEL,   // Label backgrounds, drawn right before the glyphs
+        LAYER_OVERLAY, // Selection and other overlays
+        LAYER_COUNT
+    };
+
+private:
+    struct Region {
+        float vx, vy, vcx, vcy; // Viewport in window space
+        float left, right, top, bottom; // Orthographic projection
+    };
+
+    struct Vertex {
+        float x, y;
+        uint32_t color;
+    };
+
+    struct TextVertex {
+        float x, y, u, v;
+        uint32_t color;
+    };
+
+    std::vector<Vertex> m_layers[LAYER_COUNT];
+    std::vector<TextVertex> m_text; // Label glyphs, drawn on top of the label layer
+    std::vector<Region> m_regions;
+    gs_vertbuffer_t* m_vb {};
+    gs_vertbuffer_t* m_text_vb {};
+    size_t m_vb_capacity {}, m_text_vb_capacity {};
+    uint32_t m_cx {}, m_cy {};
+
+    static DrawList* s_current;
+
+    void Draw(size_t vertex_count, int last_layer);
+    void DrawGlyphs();
+    void PushWindowSpace();
+    void PopWindowSpace();
+
+public:
+    DrawList() = default;
+    ~DrawList();
+
+    /// Starts collecting quads for a window with the given size in pixels
+    void Begin(uint32_t cx, uint32_t cy);
+    /// Draws everything that's left and stops collecting
+    void End();
+
+    void PushRegion(float vx, float vy, float vcx, float vcy, float left, float right, float top, float bottom);
+    void PopRegion();
+
+    /// Adds a quad in the coordinate space of the current matrix and region
+    void AddQuad(float x, float y, float cx, float cy, uint32_t argb, Layer layer);
+
+    /// Adds a textured glyph quad of the label atlas, unlike AddQuad the
+    /// current matrix may also rotate it
+    void AddGlyph(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, uint32_t argb);
+
+    /// Draws all layers up to and including the given one
+    void Flush(Layer last = LAYER_OVERLAY);
+    /// Draws all queued glyphs with one draw call
+    void FlushText();
+
+    /// The draw list of the layout that is currently rendering, if any
+    static DrawList* Current() { return s_current; }
+};
@@ -0,0 +1,76 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "gpu_timer.hpp"
+#include <algorithm>
+
+GpuTimer::~GpuTimer()
+{
+    obs_enter_graphics();
+    for (auto& q : m_queries) {
+        gs_timer_destroy(q.timer);
+        gs_timer_range_destroy(q.range);
+    }
+    obs_leave_graphics();
+}
+
+void GpuTimer::Collect(Query& q)
+{
+    q.pending = false;
+
+    bool disjoint {};
+    uint64_t frequency {}, ticks {};
+    if (!gs_timer_range_get_data(q.range, &disjoint, &frequency) || disjoint || !frequency)
+        return;
+    if (!gs_timer_get_data(q.timer, &ticks))
+        return;
+
+    double const gpu_ns = double(ticks) * 1000000000.0 / double(frequency);
+    if (q.cpu_ns > 0)
+        m_factor = std::max(1.0, gpu_ns / double(q.cpu_ns));
+}
+
+void GpuTimer::Begin()
+{
+    auto& q = m_queries[m_index];
+    if (q.pending)
+        Collect(q);
+
+    if (!q.range)
+        q.range = gs_timer_range_create();
+    if (!q.timer)
+        q.timer = gs_timer_create();
+    if (!q.range || !q.timer)
+        return;
+
+    gs_timer_range_begin(q.range);
+    gs_timer_begin(q.timer);
+}
+
+void GpuTimer::End(uint64_t cpu_ns)
+{
+    auto& q = m_queries[m_index];
+    if (!q.range || !q.timer)
+        return;
+
+    gs_timer_end(q.timer);
+    gs_timer_range_end(q.range);
+    q.cpu_ns = cpu_ns;
+    q.pending = true;
+    m_index = (m_index + 1) % Depth;
+}
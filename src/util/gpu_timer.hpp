@@ -0,0 +1,54 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <obs-module.h>
+
+/* Measures how long the GPU takes for a section of a frame. Results arrive a
+ * few frames late, so queries are kept in a small ring and read back once the
+ * ring comes around instead of stalling for them. Graphics thread only.
+ */
+class GpuTimer {
+    static constexpr int Depth = 3;
+
+    struct Query {
+        gs_timer_range_t* range {};
+        gs_timer_t* timer {};
+        uint64_t cpu_ns {}; // CPU time of the same section, to relate both
+        bool pending {};
+    } m_queries[Depth] {};
+
+    int m_index {};
+    double m_factor { 1 };
+
+    void Collect(Query& q);
+
+public:
+    GpuTimer() = default;
+    ~GpuTimer();
+    GpuTimer(GpuTimer const&) = delete;
+    GpuTimer& operator=(GpuTimer const&) = delete;
+
+    void Begin();
+    /// cpu_ns is how long the CPU spent submitting the measured section
+    void End(uint64_t cpu_ns);
+
+    /// How much longer the GPU took than the CPU, at least 1
+    double Factor() const { return m_factor; }
+};
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "json_bridge.hpp"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QVariant>
+
+namespace JsonBridge {
+
+QJsonValue ToQt(json_t const* json)
+{
+    if (!json)
+        return QJsonValue::Undefined;
+
+    switch (json_typeof(json)) {
+    case JSON_OBJECT: {
+        QJsonObject obj;
+        char const* key;
+        json_t* value;
+        // Keys and strings are UTF-8 and may contain null characters
+        json_object_foreach(const_cast<json_t*>(json), key, value)
+        {
+            obj.insert(QString::fromUtf8(key, int(json_object_keylen(key))), ToQt(value));
+        }
+        return obj;
+    }
+    case JSON_ARRAY: {
+        QJsonArray arr;
+        for (size_t i = 0; i < json_array_size(json); i++)
+            arr.append(ToQt(json_array_get(json, i)));
+        return arr;
+    }
+    case JSON_STRING:
+        return QString::fromUtf8(json_string_value(json), int(json_string_length(json)));
+    case JSON_INTEGER:
+        return qint64(json_integer_value(json));
+    case JSON_REAL:
+        return json_real_value(json);
+    case JSON_TRUE:
+        return true;
+    case JSON_FALSE:
+        return false;
+    case JSON_NULL:
+    default:
+        return QJsonValue::Null;
+    }
+}
+
+json_t* ToJansson(QJsonValue const& value)
+{
+    switch (value.type()) {
+    case QJsonValue::Object: {
+        auto* obj = json_object();
+        auto const qobj = value.toObject();
+        for (auto it = qobj.begin(); it != qobj.end(); ++it) {
+            auto key = it.key().toUtf8();
+            json_object_setn_new(obj, key.constData(), size_t(key.size()), ToJansson(it.value()));
+        }
+        return obj;
+    }
+    case QJsonValue::Array: {
+        auto* arr = json_array();
+        for (auto const& v : value.toArray())
+            json_array_append_new(arr, ToJansson(v));
+        return arr;
+    }
+    case QJsonValue::String: {
+        auto str = value.toString().toUtf8();
+        return json_stringn(str.constData(), size_t(str.size()));
+    }
+    case QJsonValue::Double: {
+        // Qt keeps integers that fit into 64 bits as such, keep them integers for jansson too
+        auto v = value.toVariant();
+        if (v.userType() == QMetaType::LongLong || v.userType() == QMetaType::Int)
+            return json_integer(json_int_t(v.toLongLong()));
+        return json_real(value.toDouble());
+    }
+    case QJsonValue::Bool:
+        return json_boolean(value.toBool());
+    case QJsonValue::Null:
+    case QJsonValue::Undefined:
+    default:
+        return json_null();
+    }
+}
+
+}
@@ -0,0 +1,33 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+#pragma once
+#include <QJsonValue>
+#include <jansson.h>
+
+/* Converts between jansson and Qt json values by walking the trees directly,
+ * without formatting and parsing a json string in between.
+ */
+namespace JsonBridge {
+
+/// Converts a jansson value, a null pointer becomes an undefined value
+QJsonValue ToQt(json_t const* json);
+
+/// Converts a Qt json value, returns a new reference
+json_t* ToJansson(QJsonValue const& value);
+
+}
@@ -0,0 +1,383 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "labels.hpp"
+#include "draw_list.hpp"
+#include "util.h"
+#include <QFont>
+#include <QFontMetricsF>
+#include <QImage>
+#include <QPainter>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <util/util.hpp>
+
+namespace Labels {
+
+static constexpr int AtlasSize = 1024;
+static constexpr int GlyphSize = 32; // Font size of the glyphs in the atlas in pixels
+static constexpr int Spread = 4;     // How many atlas pixels around a glyph the distance field covers
+static constexpr int Oversample = 4; // Glyphs are rasterized this much larger before the field is computed
+
+static std::mutex LabelMutex;
+static std::map<std::string, std::weak_ptr<Text>> Texts;
+static QThreadPool* Workers = nullptr;
+
+struct GlyphInfo {
+    Glyph quad {};
+    float advance {};
+    bool empty { true }; // Spaces etc. only advance the pen
+};
+
+static struct {
+    std::mutex mutex;
+    std::unordered_map<char32_t, GlyphInfo> glyphs;
+    std::vector<uint8_t> pixels; // CPU copy, uploaded by UpdateAtlas
+    int shelf_x {}, shelf_y {}, shelf_h {};
+    bool dirty {}, full {};
+
+    gs_texture_t* texture {};
+    gs_effect_t* effect {};
+} atlas;
+
+static QThreadPool* GetWorkers()
+{
+    if (!Workers) {
+        Workers = new QThreadPool;
+        Workers->setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    }
+    return Workers;
+}
+
+struct FieldPoint {
+    int dx, dy; // Offset to the closest seed pixel
+    int Dist2() const { return dx * dx + dy * dy; }
+};
+
+static constexpr FieldPoint FarAway { 1 << 12, 1 << 12 };
+
+// Two pass 8-point sequential euclidean distance transform
+static void Sweep(std::vector<FieldPoint>& grid, int w, int h)
+{
+    auto compare = [&](FieldPoint& p, int x, int y, int ox, int oy) {
+        x += ox;
+        y += oy;
+        if (x < 0 || y < 0 || x >= w || y >= h)
+            return;
+        FieldPoint other = grid[y * w + x];
+        other.dx += ox;
+        other.dy += oy;
+        if (other.Dist2() < p.Dist2())
+            p = other;
+    };
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            auto& p = grid[y * w + x];
+            compare(p, x, y, -1, 0);
+            compare(p, x, y, 0, -1);
+            compare(p, x, y, -1, -1);
+            compare(p, x, y, 1, -1);
+        }
+        for (int x = w - 1; x >= 0; x--)
+            compare(grid[y * w + x], x, y, 1, 0);
+    }
+
+    for (int y = h - 1; y >= 0; y--) {
+        for (int x = w - 1; x >= 0; x--) {
+            auto& p = grid[y * w + x];
+            compare(p, x, y, 1, 0);
+            compare(p, x, y, 0, 1);
+            compare(p, x, y, -1, 1);
+            compare(p, x, y, 1, 1);
+        }
+        for (int x = 0; x < w; x++)
+            compare(grid[y * w + x], x, y, -1, 0);
+    }
+}
+
+// Turns the oversampled coverage into a distance field of w x h pixels
+static void WriteField(QImage const& img, uint8_t* out, int w, int h)
+{
+    int const iw = img.width(), ih = img.height();
+    std::vector<FieldPoint> to_inside(iw * ih), to_outside(iw * ih);
+    for (int y = 0; y < ih; y++) {
+        auto const* line = reinterpret_cast<QRgb const*>(img.constScanLine(y));
+        for (int x = 0; x < iw; x++) {
+            bool inside = qAlpha(line[x]) >= 128;
+            to_inside[y * iw + x] = inside ? FieldPoint {} : FarAway;
+            to_outside[y * iw + x] = inside ? FarAway : FieldPoint {};
+        }
+    }
+    Sweep(to_inside, iw, ih);
+    Sweep(to_outside, iw, ih);
+
+    float const range = 2.f * Spread * Oversample;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int i = (y * Oversample + Oversample / 2) * iw + x * Oversample + Oversample / 2;
+            // Positive outside of the glyph
+            float dist = std::sqrt(float(to_inside[i].Dist2())) - std::sqrt(float(to_outside[i].Dist2()));
+            float value = qBound(0.f, 0.5f - dist / range, 1.f);
+            out[y * w + x] = uint8_t(value * 255.f + .5f);
+        }
+    }
+}
+
+// A glyph with its distance field, before it has a place in the atlas
+struct RasterGlyph {
+    GlyphInfo info; // Texture coordinates are set by PlaceGlyph
+    int w {}, h {};
+    std::vector<uint8_t> field;
+};
+
+// QFont isn't safe to share between threads, every worker uses its own
+static QFont GlyphFont()
+{
+    QFont font;
+#if defined(_WIN32)
+    font.setFamily("Arial");
+#elif defined(__APPLE__)
+    font.setFamily("Helvetica");
+#else
+    font.setFamily("Monospace");
+#endif
+    font.setBold(true);
+    font.setPixelSize(GlyphSize * Oversample);
+    return font;
+}
+
+// Runs without the atlas mutex, this is where almost all the time goes
+static RasterGlyph RasterizeGlyph(QFont const& font, char32_t c)
+{
+    QString const str = QString::fromUcs4(&c, 1);
+    QFontMetricsF const metrics(font);
+    float const em = GlyphSize * Oversample;
+
+    RasterGlyph glyph;
+    glyph.info.advance = metrics.horizontalAdvance(str) / em;
+    QRectF const bounds = metrics.boundingRect(str); // Relative to the pen on the baseline
+    if (bounds.isEmpty())
+        return glyph;
+
+    int const w = int(std::ceil(bounds.width() / Oversample)) + Spread * 2;
+    int const h = int(std::ceil(bounds.height() / Oversample)) + Spread * 2;
+
+    QImage img(w * Oversample, h * Oversample, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+    QPainter p(&img);
+    p.setRenderHint(QPainter::TextAntialiasing);
+    p.setFont(font);
+    p.setPen(Qt::white);
+    float const pad = Spread * Oversample;
+    p.drawText(QPointF(pad - bounds.left(), pad - bounds.top()), str);
+    p.end();
+
+    glyph.w = w;
+    glyph.h = h;
+    glyph.field.resize(w * h);
+    WriteField(img, glyph.field.data(), w, h);
+
+    float const x0 = (bounds.left() - pad) / em;
+    float const y0 = (metrics.ascent() + bounds.top() - pad) / em;
+    glyph.info.quad = { x0, y0, x0 + w * Oversample / em, y0 + h * Oversample / em, 0, 0, 0, 0 };
+    glyph.info.empty = false;
+    return glyph;
+}
+
+// Has to be called with the atlas mutex held, only copies the finished field
+static GlyphInfo PlaceGlyph(RasterGlyph const& glyph)
+{
+    GlyphInfo info = glyph.info;
+    if (info.empty)
+        return info;
+
+    if (atlas.pixels.empty())
+        atlas.pixels.resize(AtlasSize * AtlasSize);
+
+    // Simple shelf packing, glyphs are never removed
+    int const w = glyph.w, h = glyph.h;
+    if (atlas.shelf_x + w > AtlasSize) {
+        atlas.shelf_x = 0;
+        atlas.shelf_y += atlas.shelf_h;
+        atlas.shelf_h = 0;
+    }
+    if (atlas.shelf_y + h > AtlasSize) {
+        if (!atlas.full)
+            bwarn("Label atlas is full, some characters won't be drawn");
+        atlas.full = true;
+        info.empty = true;
+        return info;
+    }
+    int const ax = atlas.shelf_x, ay = atlas.shelf_y;
+    atlas.shelf_x += w + 1;
+    atlas.shelf_h = qMax(atlas.shelf_h, h + 1);
+
+    for (int y = 0; y < h; y++)
+        std::copy_n(glyph.field.data() + y * w, w, atlas.pixels.data() + (ay + y) * AtlasSize + ax);
+    atlas.dirty = true;
+
+    info.quad.u0 = ax / float(AtlasSize);
+    info.quad.v0 = ay / float(AtlasSize);
+    info.quad.u1 = (ax + w) / float(AtlasSize);
+    info.quad.v1 = (ay + h) / float(AtlasSize);
+    return info;
+}
+
+void Text::Build(std::string const& text)
+{
+    // The padding used to be added to the text sources as well
+    QString const str = " " + utf8_to_qt(text.c_str()) + " ";
+    QFont const font = GlyphFont();
+
+    float pen = 0;
+    for (char32_t c : str.toUcs4()) {
+        GlyphInfo info;
+        bool known;
+        {
+            std::lock_guard<std::mutex> lock(atlas.mutex);
+            auto it = atlas.glyphs.find(c);
+            known = it != atlas.glyphs.end();
+            if (known)
+                info = it->second;
+        }
+
+        if (!known) {
+            auto glyph = RasterizeGlyph(font, c);
+            std::lock_guard<std::mutex> lock(atlas.mutex);
+            auto it = atlas.glyphs.find(c);
+            if (it == atlas.glyphs.end()) // Another worker might have added it meanwhile
+                it = atlas.glyphs.emplace(c, PlaceGlyph(glyph)).first;
+            info = it->second;
+        }
+
+        if (!info.empty) {
+            auto quad = info.quad;
+            quad.x0 += pen;
+            quad.x1 += pen;
+            m_glyphs.push_back(quad);
+        }
+        pen += info.advance;
+    }
+
+    QFontMetricsF const metrics(font);
+    m_width = pen;
+    m_height = metrics.height() / (GlyphSize * Oversample);
+    m_ready.store(true, std::memory_order_release);
+}
+
+void Label::Draw(uint32_t argb) const
+{
+    auto* dl = DrawList::Current();
+    if (!dl || !Ready())
+        return; // Labels are only drawn as part of a layout
+
+    for (auto const& g : m_text->Glyphs())
+        dl->AddGlyph(g.x0 * m_size, g.y0 * m_size, g.x1 * m_size, g.y1 * m_size, g.u0, g.v0, g.u1, g.v1, argb);
+}
+
+std::shared_ptr<Label> Get(std::string const& str, float font_size)
+{
+    std::shared_ptr<Text> text;
+    {
+        std::lock_guard<std::mutex> lock(LabelMutex);
+        auto it = Texts.find(str);
+        if (it != Texts.end())
+            text = it->second.lock();
+
+        if (!text) {
+            text = std::shared_ptr<Text>(new Text, [str](Text* t) {
+                {
+                    std::lock_guard<std::mutex> lock(LabelMutex);
+                    auto it = Texts.find(str);
+                    if (it != Texts.end() && it->second.expired())
+                        Texts.erase(it);
+                }
+                delete t;
+            });
+            Texts[str] = text;
+
+            // The job only holds a weak reference, texts that were dropped
+            // before their turn are skipped
+            GetWorkers()->start([weak = std::weak_ptr<Text>(text), str] {
+                if (auto text = weak.lock())
+                    text->Build(str);
+            });
+        }
+    }
+    return std::make_shared<Label>(text, font_size);
+}
+
+void Init()
+{
+    BPtr<char> path = obs_module_file("label.effect");
+    obs_enter_graphics();
+    atlas.effect = gs_effect_create_from_file(path, nullptr);
+    obs_leave_graphics();
+
+    if (!atlas.effect)
+        berr("Failed to load label.effect, labels won't be drawn");
+}
+
+void Deinit()
+{
+    if (Workers)
+        Workers->waitForDone();
+    delete Workers;
+    Workers = nullptr;
+
+    std::lock_guard<std::mutex> lock(atlas.mutex);
+    obs_enter_graphics();
+    gs_texture_destroy(atlas.texture);
+    gs_effect_destroy(atlas.effect);
+    atlas.texture = nullptr;
+    atlas.effect = nullptr;
+    obs_leave_graphics();
+
+    atlas.glyphs.clear();
+    atlas.pixels = {};
+    atlas.shelf_x = atlas.shelf_y = atlas.shelf_h = 0;
+    atlas.dirty = atlas.full = false;
+}
+
+gs_texture_t* UpdateAtlas()
+{
+    if (!atlas.texture)
+        atlas.texture = gs_texture_create(AtlasSize, AtlasSize, GS_R8, 1, nullptr, GS_DYNAMIC);
+
+    // Workers only hold the lock to place an already rasterized glyph, so
+    // waiting is short and a label marked ready always has its glyphs uploaded
+    std::lock_guard<std::mutex> lock(atlas.mutex);
+    if (atlas.dirty && atlas.texture && !atlas.pixels.empty()) {
+        gs_texture_set_image(atlas.texture, atlas.pixels.data(), AtlasSize, false);
+        atlas.dirty = false;
+    }
+    return atlas.texture;
+}
+
+gs_effect_t* Effect()
+{
+    return atlas.effect;
+}
+
+}
@@ -0,0 +1,88 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <obs.hpp>
+#include <string>
+#include <vector>
+
+/* All labels are drawn from one signed distance field glyph atlas, shared by
+ * every item and every window. Strings are laid out once by a worker thread
+ * into quads in em units, labels only scale those, so text stays sharp at any
+ * cell size. Drawing queues the quads into the draw list of the layout, which
+ * draws the labels of a whole frame at once.
+ */
+namespace Labels {
+
+struct Glyph {
+    float x0, y0, x1, y1; // Quad in em units, relative to the top left corner of the text
+    float u0, v0, u1, v1; // Position in the atlas
+};
+
+/// Layout of one string, shared by all labels showing it
+class Text {
+    std::vector<Glyph> m_glyphs;
+    float m_width {}, m_height {}; // In em units
+    std::atomic<bool> m_ready {};
+
+public:
+    /// Lays out the string and adds missing glyphs to the atlas, runs on a worker
+    void Build(std::string const& text);
+
+    bool Ready() const { return m_ready.load(std::memory_order_acquire); }
+    std::vector<Glyph> const& Glyphs() const { return m_glyphs; }
+    float Width() const { return m_width; }
+    float Height() const { return m_height; }
+};
+
+class Label {
+    std::shared_ptr<Text const> m_text;
+    float m_size; // Font size in pixels
+
+public:
+    Label(std::shared_ptr<Text const> text, float size)
+        : m_text(std::move(text))
+        , m_size(size)
+    {
+    }
+
+    /// False until the worker has laid out the text
+    bool Ready() const { return m_text->Ready(); }
+    float Width() const { return Ready() ? m_text->Width() * m_size : 0; }
+    float Height() const { return Ready() ? m_text->Height() * m_size : 0; }
+
+    /// Queues the text with its top left corner at the origin of the current matrix
+    void Draw(uint32_t argb = 0xFFFFFFFF) const;
+};
+
+/// Returns a label for this text, the layout of the text is shared with all
+/// other labels showing it and created in the background if there is none yet
+std::shared_ptr<Label> Get(std::string const& text, float font_size);
+
+/// Loads/frees label.effect and the atlas texture
+void Init();
+void Deinit();
+
+/// Uploads glyphs that were added since the last frame and returns the atlas,
+/// only call from the graphics thread
+gs_texture_t* UpdateAtlas();
+gs_effect_t* Effect();
+
+}
@@ -0,0 +1,125 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+#pragma once
+#include <cfloat>
+#include <cmath>
+#include <obs-module.h>
+
+/* Meter ballistics for all channels of one meter at once. The state is kept as
+ * one array per value and every step is written as selects instead of branches,
+ * so the compiler can vectorize the channel loops (SSE/AVX/NEON depending on
+ * the target). The timing behaviour is picked at compile time with the policies below.
+ * tests/meter_ballistics_bench.cpp checks it against the former scalar code.
+ */
+namespace Ballistics {
+
+// Peak programme meter decay profiles in dB per second
+struct PpmFast {
+    static constexpr float peak_decay_rate = 40.f / 1.7f; // 40 dB / 1.7 sec
+};
+
+struct PpmMedium {
+    static constexpr float peak_decay_rate = 20.f / 1.7f; // 20 dB / 1.7 sec (Type I PPM)
+};
+
+struct PpmSlow {
+    static constexpr float peak_decay_rate = 24.f / 2.8f; // 24 dB / 2.8 sec (Type II PPM)
+};
+
+// VU meter integration, reaches 99% of the new value after this many seconds
+struct Vu {
+    static constexpr float integration_time = 0.3f;
+};
+
+// How long peak hold markers stay before they fall back to the current peak
+struct PeakHold {
+    static constexpr float peak_hold_duration = 20.f;      // 20 seconds
+    static constexpr float input_peak_hold_duration = 1.f; // 1 second
+};
+
+}
+
+template<class Ppm = Ballistics::PpmMedium, class Magnitude = Ballistics::Vu, class Hold = Ballistics::PeakHold>
+struct MeterBallistics {
+    // Latest levels from the volmeter
+    alignas(16) float current_magnitude[MAX_AUDIO_CHANNELS];
+    alignas(16) float current_peak[MAX_AUDIO_CHANNELS];
+    alignas(16) float current_input_peak[MAX_AUDIO_CHANNELS];
+
+    // Values that are displayed
+    alignas(16) float magnitude[MAX_AUDIO_CHANNELS];
+    alignas(16) float peak[MAX_AUDIO_CHANNELS];
+    alignas(16) float peak_hold[MAX_AUDIO_CHANNELS];
+    alignas(16) float peak_hold_age[MAX_AUDIO_CHANNELS]; // Seconds since the peak hold was last set
+    alignas(16) float input_peak_hold[MAX_AUDIO_CHANNELS];
+    alignas(16) float input_peak_hold_age[MAX_AUDIO_CHANNELS];
+
+    void Reset()
+    {
+        for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+            current_magnitude[i] = current_peak[i] = current_input_peak[i] = -M_INFINITE;
+            magnitude[i] = peak[i] = peak_hold[i] = input_peak_hold[i] = -M_INFINITE;
+            peak_hold_age[i] = input_peak_hold_age[i] = 0;
+        }
+    }
+
+    /// Advances all channels by dt seconds, minimum_level is the bottom of the meter in dB
+    void Step(float dt, float minimum_level)
+    {
+        // NaN and infinity compare false, so this doubles as isfinite() without a branch
+        auto finite = [](float v) { return std::fabs(v) <= FLT_MAX; };
+        // Same as the CLAMP() macro, including passing NaN through and lo winning
+        // over hi. fmin()/fmax() drop NaN instead, which keeps them from
+        // vectorizing without -ffast-math
+        auto clamp = [](float v, float lo, float hi) { return v < lo ? lo : (v > hi ? hi : v); };
+        float const decay = Ppm::peak_decay_rate * dt;
+        float const attack = dt / Magnitude::integration_time * 0.99f;
+
+        // Attack of peak is immediate, decay follows the PPM profile
+        for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+            float const c = current_peak[i];
+            float const decayed = clamp(peak[i] - decay, c, 0.f);
+            peak[i] = (c >= peak[i]) | (peak[i] != peak[i]) ? c : decayed;
+        }
+
+        // Attack of peak hold is immediate, it falls back to the peak after the hold duration
+        for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+            float const c = current_peak[i];
+            float const age = peak_hold_age[i] + dt;
+            bool const reset = (c >= peak_hold[i]) | !finite(peak_hold[i]) | (age > Hold::peak_hold_duration);
+            peak_hold[i] = reset ? c : peak_hold[i];
+            peak_hold_age[i] = reset ? 0.f : age;
+        }
+
+        for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+            float const c = current_input_peak[i];
+            float const age = input_peak_hold_age[i] + dt;
+            bool const reset = (c >= input_peak_hold[i]) | !finite(input_peak_hold[i]) | (age > Hold::input_peak_hold_duration);
+            input_peak_hold[i] = reset ? c : input_peak_hold[i];
+            input_peak_hold_age[i] = reset ? 0.f : age;
+        }
+
+        // The magnitude integrates towards the current value, jumps to it if
+        // the displayed value isn't finite yet
+        for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+            float const c = current_magnitude[i];
+            float const integrated = clamp(magnitude[i] + (c - magnitude[i]) * attack, minimum_level, 0.f);
+            magnitude[i] = finite(magnitude[i]) ? integrated : c;
+        }
+    }
+};
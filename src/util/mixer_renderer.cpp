@@ -19,6 +19,7 @@
 #include "mixer_renderer.hpp"
 #include "../items/audio_mixer.hpp"
 #include "../items/source_item.hpp"
+#include <algorithm>
 #include <obs-frontend-api.h>
 
 static void fader_update(void* data, float db)
@@ -26,38 +27,67 @@ static void fader_update(void* data, float db)
     static_cast<MixerSlider*>(data)->SetDb(db);
 }
 
-void MixerSlider::OnSourceNameChanged()
-{
-    m_parent->QueueSourceUpdate();
-}
-
 MixerSlider::MixerSlider(AudioMixerRenderer* parent, OBSSource src, int x, int y, int height, int channel_width)
     : MixerMeter(src, x, y, height, channel_width)
     , m_parent(parent)
 {
+    // Sliders start hidden, the mixer shows the ones on the current page
+    m_metered = false;
 }
 
 MixerSlider::~MixerSlider()
 {
     obs_fader_remove_callback(m_fader, fader_update, this);
-    obs_fader_destroy(m_fader);
+}
+
+void MixerSlider::OnMeterChanged(VolmeterHub::Entry*)
+{
+    // The fader is shared with every other slider of this source
+    obs_fader_remove_callback(m_fader, fader_update, this);
+    m_fader = m_meter ? m_meter->Fader() : nullptr;
+    if (m_fader) {
+        obs_fader_add_callback(m_fader, fader_update, this);
+        SetDb(obs_fader_get_db(m_fader));
+    }
+}
+
+void MixerSlider::SetVisible(bool visible)
+{
+    if (visible == m_visible)
+        return;
+    m_visible = visible;
+
+    // Hidden sliders don't need levels or a label
+    SetMetered(visible);
+    if (visible)
+        UpdateLabel();
+    else
+        m_label = nullptr;
 }
 
 void MixerSlider::Render(float cell_scale, float source_scale_x, float source_scale_y)
 {
     MixerMeter::Render(cell_scale, source_scale_x, source_scale_y);
 
+    m_mute_width = GetWidth();
+    m_mute_height = m_channel_width / cell_scale;
+
+    // mute/unmute
+    draw_rectangle(m_x, m_y + m_height - m_mute_height, m_mute_width, m_mute_height, m_muted ? ARGB32(255, 100, 100, 100) : m_foreground_nominal_color);
+
+    if (m_single_bar)
+        return;
+
     gs_matrix_push();
     gs_matrix_translate3f(m_x - 2, m_y - 3, 0.0f);
     gs_matrix_rotaa4f(0, 0, 1, RAD(90));
-    obs_source_video_render(m_label);
+    if (m_label)
+        m_label->Draw();
     gs_matrix_pop();
 
     const int handle_width = 24;
     const int handle_height = 8;
     const int slider_width = 3 * 1.5;
-    m_mute_width = GetWidth();
-    m_mute_height = m_channel_width / cell_scale;
     const int on_length = (m_height - handle_height) * GetSliderPosition();
 
     // Slider line
@@ -72,33 +102,25 @@ void MixerSlider::Render(float cell_scale, float source_scale_x, float source_sc
     gs_matrix_translate3f(m_x + GetWidth() + 15 - handle_width / 2, m_y + on_length, 0.0f);
     draw_rectangle(0, 0, handle_width, handle_height, ARGB32(255, 210, 210, 210));
     gs_matrix_pop();
-
-    // mute/unmute
-    draw_rectangle(m_x, m_y + m_height - m_mute_height, m_mute_width, m_mute_height, m_muted ? ARGB32(255, 100, 100, 100) : m_foreground_nominal_color);
 }
 
 void MixerSlider::SetSource(OBSSource src)
 {
     MixerMeter::SetSource(src);
-    auto name = std::string(obs_source_get_name(src));
-
-    if (name.length() > 30)
-        name = name.substr(0, 27) + "...";
-    m_label = CreateLabel(name.c_str(), 140, 1);
-
-    obs_fader_detach_source(m_fader);
-    obs_fader_attach_source(m_fader, m_source);
+    UpdateLabel();
     SetDb(obs_fader_get_db(m_fader));
 }
 
-void MixerSlider::SetType(obs_fader_type t)
+void MixerSlider::UpdateLabel()
 {
-    MixerMeter::SetType(t);
+    if (!m_visible)
+        return;
 
-    obs_fader_remove_callback(m_fader, fader_update, this);
-    obs_fader_destroy(m_fader);
-    m_fader = obs_fader_create(t);
-    obs_fader_add_callback(m_fader, fader_update, this);
+    auto name = std::string(obs_source_get_name(m_source));
+
+    if (name.length() > 30)
+        name = name.substr(0, 27) + "...";
+    m_label = CreateLabel(name.c_str(), 140, 1);
 }
 
 void MixerSlider::MouseEvent(const LayoutItem::MouseData& e, const DurchblickItemConfig&, uint32_t mx, uint32_t my)
@@ -132,100 +154,268 @@ void MixerSlider::MouseEvent(const LayoutItem::MouseData& e, const DurchblickIte
 
 void AudioMixerRenderer::RefreshSliderSizeAndPos()
 {
-    for (auto& slider : m_sliders) {
-        slider->SetY(m_y);
+    // Sliders are split into pages that fit into the cell, only the sliders
+    // of the current page are materialized
+    int const start = m_compact ? 10 : 35;
+    int x = start, page = 0;
+    for (auto& entry : m_sliders) {
+        auto& slider = entry.slider;
+        slider->SetSingleBar(m_compact);
+        slider->SetChannelWidth(m_channel_width);
+
+        int const footprint = m_compact ? slider->GetWidth() : slider->GetWidth() + 30; // meter + fader
+        int const step = m_compact ? slider->GetWidth() + 4 : (m_channel_width * slider->GetWidth()) * 2.5;
+        if (x != start && x + footprint > m_width) {
+            page++;
+            x = start;
+        }
+
+        entry.page = page;
+        slider->SetPos(x, m_y);
         slider->SetHeight(m_height);
+        x += step;
     }
+
+    m_page_count = page + 1;
+    m_page = qBound(0, m_page, m_page_count - 1);
+    for (auto& entry : m_sliders)
+        entry.slider->SetVisible(m_width > 0 && entry.page == m_page);
+}
+
+int AudioMixerRenderer::PageAt(int x, int y) const
+{
+    if (m_page_count < 2)
+        return -1;
+
+    // Same geometry as RenderPageIndicator
+    int const size = qMax(2, qMin(m_y / 2, m_width / (m_page_count * 2)));
+    int const left = (m_width - (m_page_count * 2 - 1) * size) / 2;
+    int const top = m_y + m_height + (m_y - size) / 2;
+    if (y < top - size || y > top + size * 2 || x < left - size / 2)
+        return -1;
+
+    int const page = (x - left + size / 2) / (size * 2);
+    return page < m_page_count ? page : -1;
+}
+
+void AudioMixerRenderer::RenderPageIndicator()
+{
+    if (m_page_count < 2)
+        return;
+
+    int const size = qMax(2, qMin(m_y / 2, m_width / (m_page_count * 2)));
+    int const left = (m_width - (m_page_count * 2 - 1) * size) / 2;
+    int const top = m_y + m_height + (m_y - size) / 2;
+    for (int i = 0; i < m_page_count; i++) {
+        LayoutItem::QueueBox(left + i * size * 2, top, size, size,
+            i == m_page ? ARGB32(255, 210, 210, 210) : ARGB32(255, 100, 100, 100));
+    }
+}
+
+static bool ShowInMixer(obs_source_t* src)
+{
+    uint32_t flags = obs_source_get_output_flags(src);
+    if ((flags & OBS_SOURCE_AUDIO) == 0 || !obs_source_active(src) || !obs_source_audio_active(src))
+        return false;
+
+    OBSDataAutoRelease priv_settings = obs_source_get_private_settings(src);
+    return !obs_data_get_bool(priv_settings, "mixer_hidden");
 }
 
 AudioMixerRenderer::AudioMixerRenderer(AudioMixerItem* parent, int height, int channel_width)
     : m_height(height)
     , m_channel_width(channel_width)
     , m_parent(parent)
+    , m_desktop_string(QApplication::translate("", "Basic.DesktopDevice1"))
+    , m_mic_string(QApplication::translate("", "Basic.AuxDevice1"))
 {
     UpdateSources();
+
+    auto* sh = obs_get_signal_handler();
+    int i = 0;
+    for (auto const* signal : { "source_create", "source_activate", "source_deactivate",
+             "source_audio_activate", "source_audio_deactivate", "source_rename" })
+        m_signals[i++].Connect(sh, signal, SourceChanged, this);
+    m_signals[i++].Connect(sh, "source_destroy", SourceDestroyed, this);
 }
 
-void AudioMixerRenderer::UpdateSources()
+void AudioMixerRenderer::SourceChanged(void* data, calldata_t* cd)
 {
-    m_sliders.clear();
+    static_cast<AudioMixerRenderer*>(data)->QueueSourceUpdate(static_cast<obs_source_t*>(calldata_ptr(cd, "source")));
+}
 
+void AudioMixerRenderer::SourceDestroyed(void* data, calldata_t* cd)
+{
+    // The source can't be referenced anymore at this point, it only matters
+    // if we still have a slider for it
+    auto* self = static_cast<AudioMixerRenderer*>(data);
+    std::lock_guard<std::mutex> lock(self->m_pending_mutex);
+    self->m_destroyed_sources.emplace_back(static_cast<obs_source_t*>(calldata_ptr(cd, "source")));
+}
+
+void AudioMixerRenderer::QueueSourceUpdate(obs_source_t* src)
+{
+    OBSSource ref = src; // Keeps the source alive until the change is applied
+    if (!ref)
+        return;
+    std::lock_guard<std::mutex> lock(m_pending_mutex);
+    auto queued = std::find_if(m_pending_sources.begin(), m_pending_sources.end(), [src](OBSSource const& s) {
+        return s.Get() == src;
+    });
+    if (queued == m_pending_sources.end())
+        m_pending_sources.emplace_back(std::move(ref));
+}
+
+AudioMixerRenderer::Entry AudioMixerRenderer::MakeEntry(obs_source_t* src, std::unique_ptr<MixerSlider> slider)
+{
     /* We keep global audio sources in the front
      * because I thought that that's what the mixer in obs does, but then
      * i found out that it doesn't do that and i already wrote the code
      */
-    struct data {
-        std::vector<OBSSource> active_audio_srcs;
-        std::vector<OBSSource> active_global_audio_srcs;
-        QString desktop_string = QApplication::translate("", "Basic.DesktopDevice1");
-        QString mic_string = QApplication::translate("", "Basic.AuxDevice1");
-    } d;
+    auto name = utf8_to_qt(obs_source_get_name(src));
+    bool global = name.startsWith(m_desktop_string) || name.startsWith(m_mic_string);
+    return Entry { global, name.toLower(), name, std::move(slider) };
+}
+
+std::vector<AudioMixerRenderer::Entry>::iterator AudioMixerRenderer::FindSlider(obs_source_t* src)
+{
+    return std::find_if(m_sliders.begin(), m_sliders.end(), [src](Entry const& e) {
+        return e.slider->GetSource() == src;
+    });
+}
+
+void AudioMixerRenderer::InsertSlider(obs_source_t* src)
+{
+    auto* slider = new MixerSlider(this, src, 0, m_y, m_height, m_channel_width);
+    slider->SetType(OBS_FADER_LOG);
+    slider->SetSource(src);
+    auto entry = MakeEntry(src, std::unique_ptr<MixerSlider>(slider));
+    auto pos = std::upper_bound(m_sliders.begin(), m_sliders.end(), entry);
+    m_sliders.insert(pos, std::move(entry));
+}
+
+void AudioMixerRenderer::RemoveSlider(obs_source_t* src)
+{
+    auto it = FindSlider(src);
+    if (it != m_sliders.end())
+        m_sliders.erase(it);
+}
+
+void AudioMixerRenderer::SyncSource(obs_source_t* src)
+{
+    auto it = FindSlider(src);
+    bool show = ShowInMixer(src);
+
+    if (it == m_sliders.end()) {
+        if (show)
+            InsertSlider(src);
+        return;
+    }
+
+    if (!show) {
+        m_sliders.erase(it);
+        return;
+    }
+
+    // Possibly renamed, only this slider has to move
+    auto entry = MakeEntry(src, nullptr);
+    if (entry.name == it->name)
+        return;
+    entry.slider = std::move(it->slider);
+    entry.slider->UpdateLabel();
+    m_sliders.erase(it);
+    auto pos = std::upper_bound(m_sliders.begin(), m_sliders.end(), entry);
+    m_sliders.insert(pos, std::move(entry));
+}
+
+void AudioMixerRenderer::ApplyPendingChanges()
+{
+    std::vector<OBSSource> pending;
+    std::vector<obs_source_t*> destroyed;
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        pending.swap(m_pending_sources);
+        destroyed.swap(m_destroyed_sources);
+    }
+
+    if (pending.empty() && destroyed.empty())
+        return;
+
+    for (auto* src : destroyed)
+        RemoveSlider(src);
+    for (auto& src : pending)
+        SyncSource(src);
+    m_layout_dirty = true;
+}
+
+void AudioMixerRenderer::UpdateSources()
+{
+    std::lock_guard<std::mutex> lock(m_sliders_mutex);
+    m_sliders.clear();
 
     obs_enum_sources(
         [](void* param, obs_source_t* src) {
-            uint32_t flags = obs_source_get_output_flags(src);
-
-            if ((flags & OBS_SOURCE_AUDIO) != 0 && obs_source_active(src)) {
-                OBSDataAutoRelease priv_settings = obs_source_get_private_settings(src);
-                bool hidden = obs_data_get_bool(priv_settings, "mixer_hidden");
-
-                auto* d = static_cast<data*>(param);
-                if (obs_source_audio_active(src) && !hidden) {
-                    auto name = utf8_to_qt(obs_source_get_name(src));
-                    if (name.startsWith(d->desktop_string) || name.startsWith(d->mic_string)) {
-                        d->active_global_audio_srcs.emplace_back(src);
-                    } else {
-                        d->active_audio_srcs.emplace_back(src);
-                    }
-                }
+            auto* self = static_cast<AudioMixerRenderer*>(param);
+            if (ShowInMixer(src)) {
+                auto* slider = new MixerSlider(self, src, 0, self->m_y, self->m_height, self->m_channel_width);
+                slider->SetType(OBS_FADER_LOG);
+                slider->SetSource(src);
+                self->m_sliders.emplace_back(self->MakeEntry(src, std::unique_ptr<MixerSlider>(slider)));
             }
             return true;
         },
-        &d);
+        this);
 
-    std::sort(d.active_audio_srcs.begin(), d.active_audio_srcs.end(), [](auto const& a, auto const& b) {
-        return utf8_to_qt(obs_source_get_name(a)).toLower() < utf8_to_qt(obs_source_get_name(b)).toLower();
-    });
-    std::sort(d.active_global_audio_srcs.begin(), d.active_global_audio_srcs.end(), [](auto const& a, auto const& b) {
-        return utf8_to_qt(obs_source_get_name(a)).toLower() < utf8_to_qt(obs_source_get_name(b)).toLower();
-    });
-
-    int x = 35;
-
-    d.active_audio_srcs.insert(d.active_audio_srcs.begin(), d.active_global_audio_srcs.begin(), d.active_global_audio_srcs.end());
-
-    for (auto& src : d.active_audio_srcs) {
-        auto* slider = new MixerSlider(this, src, x, 0, m_height, m_channel_width);
-        slider->SetType(OBS_FADER_LOG);
-        slider->SetSource(src);
-        m_sliders.emplace_back(slider);
-        x += (m_channel_width * slider->GetWidth()) * 2.5;
-    }
+    std::sort(m_sliders.begin(), m_sliders.end());
+    m_layout_dirty = true;
 }
 
 void AudioMixerRenderer::Render(float cell_scale, float source_scale_x, float source_scale_y)
 {
-    for (auto& slider : m_sliders)
-        slider->Render(cell_scale, source_scale_x, source_scale_y);
-
-    if (m_update_queued) {
-        m_update_queued = false;
-        UpdateSources();
+    std::lock_guard<std::mutex> lock(m_sliders_mutex);
+    if (m_release_requested.exchange(false)) {
+        for (auto& entry : m_sliders)
+            entry.slider->SetVisible(false);
+    }
+    ApplyPendingChanges();
+    if (m_layout_dirty.exchange(false)) {
+        m_compact = m_requested_compact;
+        m_page = m_requested_page;
         RefreshSliderSizeAndPos();
     }
+
+    for (auto& entry : m_sliders) {
+        if (entry.page == m_page)
+            entry.slider->Render(cell_scale, source_scale_x, source_scale_y);
+    }
+    RenderPageIndicator();
 }
 
 void AudioMixerRenderer::Update(const DurchblickItemConfig&)
 {
     auto h = m_parent->Height() * 0.8;
     auto y = (m_parent->Height() * .2) / 2;
+    std::lock_guard<std::mutex> lock(m_sliders_mutex);
     m_height = h;
     m_y = y;
-    RefreshSliderSizeAndPos();
+    m_width = m_parent->Width();
+    m_layout_dirty = true;
 }
 
 void AudioMixerRenderer::MouseEvent(const LayoutItem::MouseData& e, const DurchblickItemConfig& cfg)
 {
-    for (auto& slider : m_sliders)
-        slider->MouseEvent(e, cfg, m_parent->MouseX(), m_parent->MouseY());
+    auto mx = m_parent->MouseX(), my = m_parent->MouseY();
+    std::lock_guard<std::mutex> lock(m_sliders_mutex);
+    if (e.type == QEvent::MouseButtonPress && e.buttons & Qt::LeftButton) {
+        auto page = PageAt(mx, my);
+        if (page >= 0) {
+            SetPage(page);
+            return;
+        }
+    }
+
+    for (auto& entry : m_sliders) {
+        if (entry.slider->IsVisible())
+            entry.slider->MouseEvent(e, cfg, mx, my);
+    }
 }
@@ -19,22 +19,27 @@
 #pragma once
 #include "../items/item.hpp"
 #include "callbacks.h"
+#include "labels.hpp"
 #include "volume_meter.hpp"
+#include <QString>
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 class AudioMixerRenderer;
 
 class MixerSlider : public MixerMeter {
-    OBSSource m_label {};
+    std::shared_ptr<Labels::Label> m_label {};
     obs_fader_t* m_fader {};
     bool m_dragging_volume { false }, m_lmb_down { false };
+    bool m_visible { false };
     float m_db {}, m_fade { 1 };
     AudioMixerRenderer* m_parent {};
     int m_mute_width;
     int m_mute_height;
 
 protected:
-    void OnSourceNameChanged() override;
+    void OnMeterChanged(VolmeterHub::Entry* old) override;
 
     void OnSourceVolumeChanged() override
     {
@@ -56,8 +61,11 @@ public:
     }
 
     void SetSource(OBSSource) override;
+    void UpdateLabel();
 
-    void SetType(obs_fader_type) override;
+    /// Off-screen sliders release their label and volmeter subscription
+    void SetVisible(bool visible);
+    bool IsVisible() const { return m_visible; }
 
     void SetDb(float db)
     {
@@ -72,6 +80,8 @@ public:
 
     bool MouseOverSlider(int x, int y)
     {
+        if (m_single_bar)
+            return false;
         const int slider_width = m_channel_width * 1.5;
         const int left = m_x + GetWidth() + 2;
         const int right = m_x + GetWidth() + 20 + slider_width;
@@ -79,32 +89,103 @@ public:
     }
 
     void MouseEvent(const LayoutItem::MouseData& e, const DurchblickItemConfig& cfg, uint32_t mx, uint32_t my);
+    void MouseLeave() { m_lmb_down = false; }
 };
 
 class AudioMixerItem;
 
 class AudioMixerRenderer {
-    std::vector<std::unique_ptr<MixerSlider>> m_sliders;
-    int m_height {}, m_y {}, m_channel_width {};
+    struct Entry {
+        bool global;      // Desktop/mic audio, sorted before everything else
+        QString sort_key; // Lower case name, computed once per rename
+        QString name;
+        std::unique_ptr<MixerSlider> slider;
+        int page;
+
+        bool operator<(Entry const& o) const
+        {
+            return global != o.global ? global : sort_key < o.sort_key;
+        }
+    };
+
+    // Sorted by Entry::operator<. The mutex guards the sliders and their
+    // geometry, the graphics thread renders them while the UI thread routes
+    // mouse events to them
+    std::mutex m_sliders_mutex;
+    std::vector<Entry> m_sliders;
+    int m_height {}, m_y {}, m_width {}, m_channel_width {};
+    int m_page {}, m_page_count { 1 };
+    bool m_compact {};
+
+    // Changes from the UI thread, applied before the next frame so sliders
+    // are only ever created, shown or hidden on the graphics thread
+    std::atomic<bool> m_layout_dirty { true };
+    std::atomic<int> m_requested_page { 0 };
+    std::atomic<bool> m_requested_compact { false };
+    std::atomic<bool> m_release_requested { false };
     AudioMixerItem* m_parent {};
-    bool m_update_queued { false };
+    QString m_desktop_string, m_mic_string;
+
+    // Sources whose mixer state might have changed, filled from libobs
+    // signals on any thread and applied on the next frame
+    std::mutex m_pending_mutex;
+    std::vector<OBSSource> m_pending_sources;
+    std::vector<obs_source_t*> m_destroyed_sources;
+    OBSSignal m_signals[7];
 
     void RefreshSliderSizeAndPos();
+    void ApplyPendingChanges();
+    void RenderPageIndicator();
+    int PageAt(int x, int y) const;
+    void SyncSource(obs_source_t* src);
+    void InsertSlider(obs_source_t* src);
+    void RemoveSlider(obs_source_t* src);
+    Entry MakeEntry(obs_source_t* src, std::unique_ptr<MixerSlider> slider);
+    std::vector<Entry>::iterator FindSlider(obs_source_t* src);
+
+    static void SourceChanged(void* data, calldata_t* cd);
+    static void SourceDestroyed(void* data, calldata_t* cd);
 
 public:
     AudioMixerRenderer(AudioMixerItem* parent, int height = 100, int channel_width = 3);
     ~AudioMixerRenderer() = default;
 
     void UpdateSources();
-    void QueueSourceUpdate() { m_update_queued = true; }
+    void QueueSourceUpdate(obs_source_t* src);
     void Render(float cell_scale, float source_scale_x, float source_scale_y);
     void Update(DurchblickItemConfig const& cfg);
 
     void MouseEvent(const LayoutItem::MouseData& e, const DurchblickItemConfig& cfg);
+    void MouseLeave()
+    {
+        std::lock_guard<std::mutex> lock(m_sliders_mutex);
+        for (auto& entry : m_sliders)
+            entry.slider->MouseLeave();
+    }
     void SetChannelWidth(int w)
     {
+        std::lock_guard<std::mutex> lock(m_sliders_mutex);
         m_channel_width = w;
-        for (auto& slider : m_sliders)
-            slider->SetChannelWidth(w);
+        m_layout_dirty = true;
+    }
+
+    void SetCompact(bool compact)
+    {
+        m_requested_compact = compact;
+        m_layout_dirty = true;
+    }
+
+    /// Drops the labels and volmeter subscriptions of all sliders at the start
+    /// of the next frame, which then gives the current page its own back
+    void Release()
+    {
+        m_release_requested = true;
+        m_layout_dirty = true;
+    }
+
+    void SetPage(int page)
+    {
+        m_requested_page = page;
+        m_layout_dirty = true;
     }
 };
@@ -0,0 +1,231 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "source_cache.hpp"
+#include <algorithm>
+#include <graphics/vec4.h>
+#include <util/platform.h>
+
+// Entries that haven't been drawn for this many frames give their texture back
+static constexpr uint64_t EvictAfterFrames = 120;
+static constexpr size_t MaxPoolSize = 8;
+
+// Renders a w x h source into a cx x cy texture with premultiplied alpha, so it blends like the source would
+static bool BeginTexture(gs_texrender_t* texrender, uint32_t cx, uint32_t cy, uint32_t w, uint32_t h)
+{
+    gs_texrender_reset(texrender);
+    if (!gs_texrender_begin(texrender, cx, cy))
+        return false;
+
+    vec4 clear;
+    vec4_zero(&clear);
+    gs_clear(GS_CLEAR_COLOR, &clear, 0.0f, 0);
+    gs_ortho(0.0f, float(w), 0.0f, float(h), -100.0f, 100.0f);
+
+    gs_blend_state_push();
+    gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+    return true;
+}
+
+static void EndTexture(gs_texrender_t* texrender)
+{
+    gs_blend_state_pop();
+    gs_texrender_end(texrender);
+}
+
+static void DrawTexture(gs_texture_t* tex, uint32_t w, uint32_t h)
+{
+    gs_effect_t* effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), tex);
+
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+    while (gs_effect_loop(effect, "Draw"))
+        gs_draw_sprite(tex, 0, w, h);
+    gs_blend_state_pop();
+}
+
+std::unordered_map<obs_source_t*, SourceCache::Entry> SourceCache::s_entries;
+std::vector<gs_texrender_t*> SourceCache::s_pool;
+uint64_t SourceCache::s_frame = 1; // 0 means never for the frame counters of an entry
+
+void SourceCache::Init()
+{
+    obs_add_tick_callback(Tick, nullptr);
+}
+
+void SourceCache::Deinit()
+{
+    obs_remove_tick_callback(Tick, nullptr);
+    obs_enter_graphics();
+    for (auto& it : s_entries)
+        gs_texrender_destroy(it.second.texrender);
+    for (auto* texrender : s_pool)
+        gs_texrender_destroy(texrender);
+    obs_leave_graphics();
+    s_entries.clear();
+    s_pool.clear();
+}
+
+void SourceCache::Recycle(Entry& e)
+{
+    if (!e.texrender)
+        return;
+    if (s_pool.size() < MaxPoolSize)
+        s_pool.push_back(e.texrender);
+    else
+        gs_texrender_destroy(e.texrender);
+    e.texrender = nullptr;
+}
+
+void SourceCache::Tick(void*, float)
+{
+    s_frame++;
+
+    bool evict = false;
+    for (auto const& it : s_entries)
+        evict |= s_frame - it.second.used_frame > EvictAfterFrames;
+    if (!evict)
+        return;
+
+    obs_enter_graphics();
+    for (auto it = s_entries.begin(); it != s_entries.end();) {
+        if (s_frame - it->second.used_frame > EvictAfterFrames) {
+            Recycle(it->second);
+            it = s_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    obs_leave_graphics();
+}
+
+void SourceCache::Render(obs_source_t* src, uint32_t cx, uint32_t cy)
+{
+    uint32_t w = obs_source_get_width(src);
+    uint32_t h = obs_source_get_height(src);
+    if (!w || !h) {
+        obs_source_video_render(src);
+        return;
+    }
+
+    auto& e = s_entries[src];
+    if (!obs_weak_source_references_source(e.source, src)) {
+        // A new source at the address of one that was destroyed
+        Recycle(e);
+        e = {};
+        e.source = OBSGetWeakRef(src);
+    }
+
+    if (e.used_frame != s_frame) {
+        bool const consecutive = e.used_frame + 1 == s_frame;
+        e.previous_uses = consecutive ? e.uses : 0;
+        e.previous_cx = consecutive ? e.cx : 0;
+        e.previous_cy = consecutive ? e.cy : 0;
+        e.uses = e.cx = e.cy = 0;
+        e.used_frame = s_frame;
+    }
+    e.uses++;
+    e.cx = std::max(e.cx, cx ? cx : w);
+    e.cy = std::max(e.cy, cy ? cy : h);
+
+    // Sources that are only shown once would just get an extra copy
+    if (e.previous_uses < 2) {
+        obs_source_video_render(src);
+        return;
+    }
+
+    if (e.rendered_frame != s_frame) {
+        if (!e.texrender) {
+            if (!s_pool.empty()) {
+                e.texrender = s_pool.back();
+                s_pool.pop_back();
+            } else {
+                e.texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+            }
+        }
+
+        // No use needs more pixels than the largest cell of the last frame
+        uint32_t const tex_cx = std::clamp(e.previous_cx, 1u, w);
+        uint32_t const tex_cy = std::clamp(e.previous_cy, 1u, h);
+        if (!BeginTexture(e.texrender, tex_cx, tex_cy, w, h)) {
+            obs_source_video_render(src);
+            return;
+        }
+        obs_source_video_render(src);
+        EndTexture(e.texrender);
+        e.rendered_frame = s_frame;
+    }
+
+    DrawTexture(gs_texrender_get_texture(e.texrender), w, h);
+}
+
+ThrottledTexture::~ThrottledTexture()
+{
+    Free();
+}
+
+void ThrottledTexture::Free()
+{
+    if (!m_texrender)
+        return;
+    // Reset before leaving the graphics context, so no frame can see the dangling texrender
+    obs_enter_graphics();
+    gs_texrender_destroy(m_texrender);
+    m_texrender = nullptr;
+    m_valid = false;
+    obs_leave_graphics();
+}
+
+bool ThrottledTexture::Render(obs_source_t* src, uint32_t cx, uint32_t cy, int max_fps, Refresh refresh)
+{
+    uint32_t w = obs_source_get_width(src);
+    uint32_t h = obs_source_get_height(src);
+    if (!w || !h || (max_fps <= 0 && refresh == Refresh::Auto)) {
+        SourceCache::Render(src, cx, cy);
+        return false;
+    }
+
+    uint64_t const now = os_gettime_ns();
+    bool due = refresh == Refresh::Force;
+    if (refresh == Refresh::Auto) {
+        // A bit of slack, so 30 fps on a 60 fps canvas doesn't skip an extra frame due to jitter
+        uint64_t const interval = 1000000000ULL / uint64_t(max_fps);
+        due = now - m_last_render + 2000000ULL >= interval;
+    }
+
+    bool rendered = false;
+    if (!m_valid || due || w != m_cx || h != m_cy) {
+        if (!m_texrender)
+            m_texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+        if (!BeginTexture(m_texrender, w, h, w, h)) {
+            SourceCache::Render(src);
+            return false;
+        }
+        SourceCache::Render(src);
+        EndTexture(m_texrender);
+        m_valid = true;
+        m_last_render = now;
+        m_cx = w;
+        m_cy = h;
+        rendered = true;
+    }
+
+    DrawTexture(gs_texrender_get_texture(m_texrender), w, h);
+    return rendered;
+}
@@ -0,0 +1,88 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <obs.hpp>
+#include <unordered_map>
+#include <vector>
+
+/* Renders sources that are shown more than once per frame (e.g. the same
+ * scene in several cells, or in the dock and a projector) into a texture
+ * only once and draws that texture everywhere else. The cache lives on the
+ * graphics thread, entries are advanced once per frame by a tick callback.
+ */
+class SourceCache {
+    struct Entry {
+        OBSWeakSource source;
+        gs_texrender_t* texrender {};
+        uint64_t used_frame {}, rendered_frame {};
+        uint32_t uses {}, previous_uses {}; // How often it was drawn this/last frame
+        uint32_t cx {}, cy {}, previous_cx {}, previous_cy {}; // Largest size it was drawn at this/last frame
+    };
+
+    static std::unordered_map<obs_source_t*, Entry> s_entries;
+    static std::vector<gs_texrender_t*> s_pool; // Unused texrenders of evicted entries
+    static uint64_t s_frame;
+
+    static void Recycle(Entry& e);
+    static void Tick(void*, float);
+
+public:
+    static void Init();
+    static void Deinit();
+
+    /// Drawn like obs_source_video_render, at the source size in the current matrix.
+    /// cx/cy is the size it ends up at in pixels, 0 for the full source size.
+    /// The cached texture is only as large as the largest use of the last frame
+    static void Render(obs_source_t* src, uint32_t cx = 0, uint32_t cy = 0);
+};
+
+/* Texture of the last render of a source, refreshed at most max_fps times per
+ * second. Used by cells that don't need to update every frame.
+ */
+class ThrottledTexture {
+    gs_texrender_t* m_texrender {};
+    uint64_t m_last_render {};
+    uint32_t m_cx {}, m_cy {};
+    bool m_valid {};
+
+public:
+    enum class Refresh {
+        Auto,  // When max_fps says so
+        Skip,  // Only if there is no usable texture yet
+        Force, // Right away
+    };
+
+    ThrottledTexture() = default;
+    ~ThrottledTexture();
+    ThrottledTexture(ThrottledTexture const&) = delete;
+    ThrottledTexture& operator=(ThrottledTexture const&) = delete;
+
+    /// Like SourceCache::Render, but only re-renders the source when it is due,
+    /// max_fps <= 0 with Refresh::Auto renders every frame. Graphics thread only.
+    /// cx/cy is passed on to SourceCache::Render when the source is drawn directly.
+    /// Returns true if the texture was updated
+    bool Render(obs_source_t* src, uint32_t cx, uint32_t cy, int max_fps, Refresh refresh = Refresh::Auto);
+
+    gs_texture_t* Texture() const { return m_valid ? gs_texrender_get_texture(m_texrender) : nullptr; }
+    uint32_t Width() const { return m_cx; }
+    uint32_t Height() const { return m_cy; }
+
+    /// Frees the texture, only call while nothing is rendered
+    void Free();
+};
@@ -0,0 +1,74 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "source_index.hpp"
+#include "util.h"
+
+SourceIndex* SourceIndex::s_current = nullptr;
+
+SourceIndex::SourceIndex()
+{
+    obs_enum_all_sources([](void* d, obs_source_t* src) -> bool {
+        auto* index = static_cast<SourceIndex*>(d);
+        if (auto const* uuid = obs_source_get_uuid(src))
+            index->m_by_uuid.insert(QString::fromUtf8(uuid), src);
+        // Like obs_get_source_by_name, names only resolve to public sources
+        auto const* name = obs_source_get_name(src);
+        if (name && !obs_obj_is_private(src))
+            index->m_by_name.insert(utf8_to_qt(name), src);
+        return true;
+    },
+        this);
+
+    m_previous = s_current;
+    s_current = this;
+}
+
+SourceIndex::~SourceIndex()
+{
+    if (s_current == this)
+        s_current = m_previous;
+}
+
+obs_source_t* SourceIndex::Find(QString const& uuid, QString const& name) const
+{
+    if (!uuid.isEmpty()) {
+        auto it = m_by_uuid.constFind(uuid);
+        if (it != m_by_uuid.constEnd())
+            return it.value();
+    }
+    if (!name.isEmpty()) {
+        auto it = m_by_name.constFind(name);
+        if (it != m_by_name.constEnd())
+            return it.value();
+    }
+    return nullptr;
+}
+
+obs_source_t* SourceIndex::Resolve(QString const& uuid, QString const& name)
+{
+    if (s_current)
+        return obs_source_get_ref(s_current->Find(uuid, name));
+
+    obs_source_t* src {};
+    if (!uuid.isEmpty())
+        src = obs_get_source_by_uuid(qt_to_utf8(uuid));
+    if (!src && !name.isEmpty())
+        src = obs_get_source_by_name(qt_to_utf8(name));
+    return src;
+}
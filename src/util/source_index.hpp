@@ -0,0 +1,51 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <QHash>
+#include <QString>
+#include <obs.hpp>
+
+/* Lookup table of all sources (including scenes) by uuid and name. Layouts are
+ * loaded with one of these so every item resolves its source with a hash lookup
+ * instead of each one walking the global source list again.
+ * Only used from the UI thread.
+ */
+class SourceIndex {
+    QHash<QString, OBSSource> m_by_uuid;
+    QHash<QString, OBSSource> m_by_name;
+    SourceIndex* m_previous {};
+
+    static SourceIndex* s_current;
+
+public:
+    /// Enumerates all sources once and makes this the current index
+    SourceIndex();
+    ~SourceIndex();
+
+    /// Looks up a source by uuid first and by name if that fails (e.g. for
+    /// layouts saved before uuids were stored), returns nullptr if neither matches
+    obs_source_t* Find(QString const& uuid, QString const& name) const;
+
+    /// The index of the layout that is currently loading, if any
+    static SourceIndex* Current() { return s_current; }
+
+    /// Uses the current index if there is one and falls back to libobs otherwise,
+    /// the returned reference has to be released by the caller
+    static obs_source_t* Resolve(QString const& uuid, QString const& name);
+};
@@ -0,0 +1,62 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/* Wait-free single producer, single consumer triple buffer.
+ * The producer fills Back() and calls Publish(), the consumer calls Consume()
+ * and reads Front(). Neither side ever waits for the other, the consumer
+ * always sees the most recently published value.
+ */
+template<class T>
+class TripleBuffer {
+    static constexpr uint8_t FRESH = 0x4; // Set in m_middle when it holds unread data
+    static constexpr uint8_t INDEX = 0x3;
+
+    T m_slots[3] {};
+    std::atomic<uint8_t> m_middle { 1 };
+    uint8_t m_back { 0 };  // Only touched by the producer
+    uint8_t m_front { 2 }; // Only touched by the consumer
+
+public:
+    /// Slot the producer writes into, owned by the producer until Publish()
+    T& Back() { return m_slots[m_back]; }
+
+    /// Hands the back slot to the consumer. Returns true if the previous
+    /// value was never consumed, the new back slot then still contains it
+    bool Publish()
+    {
+        auto old = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+        m_back = old & INDEX;
+        return old & FRESH;
+    }
+
+    /// Swaps in the latest published value, returns false if there was none
+    bool Consume()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        auto old = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = old & INDEX;
+        return true;
+    }
+
+    /// Slot the consumer reads from, valid until the next Consume()
+    T const& Front() const { return m_slots[m_front]; }
+};
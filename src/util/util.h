@@ -57,10 +57,22 @@
 #define T_LABEL_GRID_SIZE               T_("Label.GridSize")
 #define T_LABEL_DISPLAY_CAPTURE         T_("Label.HideFromDisplayCapture")
 #define T_LABEL_HIDE_CURSOR             T_("Label.HideCursor")
+#define T_LABEL_BINARY_STORAGE          T_("Label.BinaryStorage")
+#define T_LABEL_RELEASE_DELAY           T_("Label.ReleaseDelay")
+#define T_LABEL_NEVER                   T_("Label.Never")
+#define T_LABEL_RENDER_BUDGET           T_("Label.RenderBudget")
+#define T_LABEL_UNLIMITED               T_("Label.Unlimited")
+#define T_LABEL_GPU_TIMING              T_("Label.GpuTiming")
+#define T_OVERLAY_THROTTLED             T_("Overlay.Throttled")
 #define T_CONFIGURATION_TITLE           T_("Config.Title")
 #define T_WIDGET_STRETCH                T_("Widget.Stretch")
 #define T_SOURCE_ITEM_LABEL             T_("SourceItem.Label")
 #define T_SOURCE_ITEM_VOLUME            T_("SourceItem.Volume")
+#define T_SOURCE_ITEM_DETECT_STATIC     T_("SourceItem.DetectStatic")
+#define T_AUDIO_MIXER_COMPACT           T_("AudioMixer.Compact")
+#define T_REFRESH_RATE                  T_("Label.RefreshRate")
+#define T_REFRESH_RATE_FULL             T_("RefreshRate.Full")
+#define T_REFRESH_RATE_FPS              T_("RefreshRate.Fps")
 #define T_WIDGET_SOURCE                 T_("Widget.SourceDisplay")
 #define T_WIDGET_SCENE                  T_("Widget.SceneDisplay")
 #define T_WIDGET_AUDIO_MIXER            T_("Widget.AudioMixer")
@@ -82,6 +94,7 @@
 #define COLOR_PREVIEW_INDICATOR         0xFF00D000
 #define COLOR_PROGRAM_INDICATOR         0xFFD00000
 #define COLOR_BLACK                     0xFF000000
+#define COLOR_THROTTLED_AMBER           0xFFFFB000
 
 #define ARGB32(a, r, g, b) ((b) | ((g) << 8) | ((r) << 16) | ((a) << 24))
 
@@ -0,0 +1,83 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "volmeter_hub.hpp"
+#include <map>
+#include <mutex>
+
+namespace VolmeterHub {
+
+static std::mutex EntryMutex;
+static std::map<std::pair<obs_source_t*, obs_fader_type>, std::weak_ptr<Entry>> Entries;
+
+Entry::Entry(obs_source_t* src, obs_fader_type type)
+    : m_source(src)
+    , m_type(type)
+{
+    m_volmeter = obs_volmeter_create(type);
+    obs_volmeter_attach_source(m_volmeter, m_source);
+}
+
+Entry::~Entry()
+{
+    obs_volmeter_detach_source(m_volmeter);
+    obs_volmeter_destroy(m_volmeter);
+    if (m_fader) {
+        obs_fader_detach_source(m_fader);
+        obs_fader_destroy(m_fader);
+    }
+}
+
+obs_fader_t* Entry::Fader()
+{
+    std::call_once(m_fader_once, [this] {
+        m_fader = obs_fader_create(m_type);
+        obs_fader_attach_source(m_fader, m_source);
+    });
+    return m_fader;
+}
+
+std::shared_ptr<Entry> Get(obs_source_t* src, obs_fader_type type)
+{
+    if (!src)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(EntryMutex);
+    auto key = std::make_pair(src, type);
+    auto it = Entries.find(key);
+    if (it != Entries.end()) {
+        if (auto entry = it->second.lock())
+            return entry;
+    }
+
+    // The entry keeps a reference to the source, so its address can't be
+    // reused for another source while the entry is in the map
+    std::shared_ptr<Entry> entry(new Entry(src, type), [key](Entry* e) {
+        {
+            std::lock_guard<std::mutex> lock(EntryMutex);
+            auto it = Entries.find(key);
+            if (it != Entries.end() && it->second.expired())
+                Entries.erase(it);
+        }
+        delete e;
+    });
+    Entries[key] = entry;
+    return entry;
+}
+
+}
@@ -0,0 +1,54 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+#pragma once
+#include <memory>
+#include <mutex>
+#include <obs.hpp>
+
+/* Process wide registry of volmeters and faders. Every view of a source shares
+ * the same obs_volmeter_t (and obs_fader_t), so the audio thread only meters
+ * a source once no matter how many meters show it. Views register their own
+ * callbacks on the shared objects, libobs fans the levels out to them.
+ */
+namespace VolmeterHub {
+
+class Entry {
+    OBSSource m_source;
+    obs_fader_type m_type;
+    obs_volmeter_t* m_volmeter {};
+    obs_fader_t* m_fader {};
+    std::once_flag m_fader_once;
+
+public:
+    Entry(obs_source_t* src, obs_fader_type type);
+    ~Entry();
+
+    obs_source_t* Source() const { return m_source; }
+    obs_volmeter_t* Volmeter() const { return m_volmeter; }
+
+    /// Fader attached to the same source, created on first use from any thread
+    obs_fader_t* Fader();
+};
+
+/// Returns the shared entry for this source and fader type, the volmeter is
+/// destroyed when the last reference goes away. The map is locked, so this is
+/// called from the UI thread and from the graphics thread when mixers apply
+/// their pending changes.
+std::shared_ptr<Entry> Get(obs_source_t* src, obs_fader_type type);
+
+}
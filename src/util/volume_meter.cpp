@@ -16,8 +16,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *************************************************************************/
 #include "volume_meter.hpp"
+#include "draw_list.hpp"
 #include "util.h"
 #include <QTimer>
+#include <algorithm>
 #include <obs.hpp>
 #include <util/platform.h>
 #include <util/util.hpp>
@@ -29,6 +31,15 @@
 #define INDICATOR_THICKNESS 3
 #define CLIP_FLASH_DURATION_MS 1000
 
+static struct {
+    gs_effect_t* effect;
+    gs_eparam_t *peak, *peak_hold, *magnitude, *nominal_level, *warning_level, *marker_size, *clipping;
+    gs_eparam_t *fg_nominal, *fg_warning, *fg_error, *bg_nominal, *bg_warning, *bg_error, *magnitude_color;
+} volume_effect {};
+
+std::mutex MixerMeter::s_meters_mutex;
+std::vector<MixerMeter*> MixerMeter::s_meters;
+
 static void on_source_muted(void* data, calldata_t* calldata)
 {
     MixerMeter* meter = static_cast<MixerMeter*>(data);
@@ -47,6 +58,12 @@ void MixerMeter::draw_rectangle(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
 {
     if (!(w > 0 && h > 0))
         return;
+
+    if (auto* dl = DrawList::Current()) {
+        dl->AddQuad(x, y, w, h, c, DrawList::LAYER_CONTENT);
+        return;
+    }
+
     gs_effect_t* solid = obs_get_base_effect(OBS_EFFECT_SOLID);
     gs_eparam_t* color = gs_effect_get_param_by_name(solid, "color");
 
@@ -58,6 +75,97 @@ void MixerMeter::draw_rectangle(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
     gs_matrix_pop();
 }
 
+void MixerMeter::Init()
+{
+    obs_add_tick_callback(Tick, nullptr);
+
+    BPtr<char> path = obs_module_file("volume.effect");
+    obs_enter_graphics();
+    volume_effect.effect = gs_effect_create_from_file(path, nullptr);
+    obs_leave_graphics();
+
+    if (!volume_effect.effect) {
+        berr("Failed to load volume.effect, falling back to solid volume meters");
+        return;
+    }
+
+#define GET_PARAM(p) volume_effect.p = gs_effect_get_param_by_name(volume_effect.effect, #p)
+    GET_PARAM(peak);
+    GET_PARAM(peak_hold);
+    GET_PARAM(magnitude);
+    GET_PARAM(nominal_level);
+    GET_PARAM(warning_level);
+    GET_PARAM(marker_size);
+    GET_PARAM(clipping);
+    GET_PARAM(fg_nominal);
+    GET_PARAM(fg_warning);
+    GET_PARAM(fg_error);
+    GET_PARAM(bg_nominal);
+    GET_PARAM(bg_warning);
+    GET_PARAM(bg_error);
+    GET_PARAM(magnitude_color);
+#undef GET_PARAM
+}
+
+void MixerMeter::Deinit()
+{
+    obs_remove_tick_callback(Tick, nullptr);
+    obs_enter_graphics();
+    gs_effect_destroy(volume_effect.effect);
+    obs_leave_graphics();
+    volume_effect = {};
+}
+
+void MixerMeter::Tick(void*, float seconds)
+{
+    // Runs once per video frame on the graphics thread, which is also the
+    // thread that renders the displays, so the display values need no locking
+    uint64_t ts = os_gettime_ns();
+    std::lock_guard<std::mutex> lock(s_meters_mutex);
+    for (auto* meter : s_meters) {
+        meter->ConsumeLevels(ts);
+        meter->m_ballistics.Step(seconds, float(meter->m_minimum_level));
+        meter->m_idle = meter->DetectIdle(ts);
+    }
+}
+
+float MixerMeter::level_position(float db) const
+{
+    // 0 is the bottom of the meter (minimum level), 1 is the top (0 dB)
+    if (!isfinite(db))
+        return db > 0 ? 1 : 0;
+    return CLAMP(float(1 - db / m_minimum_level), 0.f, 1.f);
+}
+
+void MixerMeter::draw_channel(float x, float y, float w, float h, float peak,
+    float peak_hold, float magnitude, float marker_size)
+{
+    if (!(w > 0 && h > 0))
+        return;
+
+    gs_effect_set_float(volume_effect.peak, level_position(peak));
+    gs_effect_set_float(volume_effect.peak_hold, level_position(peak_hold));
+    gs_effect_set_float(volume_effect.magnitude, level_position(magnitude));
+    gs_effect_set_float(volume_effect.nominal_level, level_position(m_warning_level));
+    gs_effect_set_float(volume_effect.warning_level, level_position(m_error_level));
+    gs_effect_set_float(volume_effect.marker_size, marker_size / h);
+    gs_effect_set_float(volume_effect.clipping, m_clipping ? 1.f : 0.f);
+
+    gs_effect_set_color(volume_effect.fg_nominal, m_muted ? m_foreground_nominal_color_disabled : m_foreground_nominal_color);
+    gs_effect_set_color(volume_effect.fg_warning, m_muted ? m_foreground_warning_color_disabled : m_foreground_warning_color);
+    gs_effect_set_color(volume_effect.fg_error, m_muted ? m_foreground_error_color_disabled : m_foreground_error_color);
+    gs_effect_set_color(volume_effect.bg_nominal, m_muted ? m_background_nominal_color_disabled : m_background_nominal_color);
+    gs_effect_set_color(volume_effect.bg_warning, m_muted ? m_background_warning_color_disabled : m_background_warning_color);
+    gs_effect_set_color(volume_effect.bg_error, m_muted ? m_background_error_color_disabled : m_background_error_color);
+    gs_effect_set_color(volume_effect.magnitude_color, m_magnitude_color);
+
+    gs_matrix_push();
+    gs_matrix_translate3f(x, y, 0);
+    while (gs_effect_loop(volume_effect.effect, "Draw"))
+        gs_draw_sprite(nullptr, 0, (uint32_t)w, (uint32_t)h);
+    gs_matrix_pop();
+}
+
 MixerMeter::MixerMeter(OBSSource src, int x, int y, int height, int channel_width)
     : m_source(src)
     , m_x(x)
@@ -70,10 +178,6 @@ MixerMeter::MixerMeter(OBSSource src, int x, int y, int height, int channel_widt
     m_error_level = -9.0;               //  -9 dB
     m_clip_level = -0.5;                //  -0.5 dB
     m_minimum_input_level = -50.0;      // -50 dB
-    m_peak_decay_rate = 11.76;          //  20 dB / 1.7 sec
-    m_magnitude_integration_time = 0.3; //  99% in 300 ms
-    m_peak_hold_duration = 20.0;        //  20 seconds
-    m_input_peak_hold_duration = 1.0;   //  1 second
 
     m_background_nominal_color = ARGB32(0xff, 0x26, 0x7f, 0x26); // Dark green
     m_background_warning_color = ARGB32(0xff, 0x7f, 0x7f, 0x26); // Dark yellow
@@ -93,48 +197,85 @@ MixerMeter::MixerMeter(OBSSource src, int x, int y, int height, int channel_widt
     m_magnitude_color = ARGB32(0xff, 0x1f, 0x1e, 0x1f);  // Dark gray
     m_major_tick_color = ARGB32(0xff, 0xff, 0xff, 0xff); // Black
     m_minor_tick_color = ARGB32(0xff, 0xcc, 0xcc, 0xcc); // Black
+
+    ResetLevels();
+    std::lock_guard<std::mutex> lock(s_meters_mutex);
+    s_meters.emplace_back(this);
 }
 
 MixerMeter::~MixerMeter()
 {
+    {
+        std::lock_guard<std::mutex> lock(s_meters_mutex);
+        s_meters.erase(std::remove(s_meters.begin(), s_meters.end(), this), s_meters.end());
+    }
     if (m_source)
         signal_handler_disconnect(obs_source_get_signal_handler(m_source), "mute", on_source_muted, this);
-    obs_volmeter_remove_callback(m_meter, volume_meter, this);
-    obs_volmeter_destroy(m_meter);
+    if (m_meter)
+        obs_volmeter_remove_callback(m_meter->Volmeter(), volume_meter, this);
 }
 
 void MixerMeter::SetType(obs_fader_type t)
 {
-    obs_volmeter_remove_callback(m_meter, volume_meter, this);
-    obs_volmeter_destroy(m_meter);
-    m_meter = obs_volmeter_create(t);
-    obs_volmeter_add_callback(m_meter, volume_meter, this);
-    m_channels = obs_volmeter_get_nr_channels(m_meter);
+    m_type = t;
+    m_has_type = true;
+    if (m_meter)
+        AttachMeter();
 }
 
-void MixerMeter::Update(const float magnitude[], const float peak[], const float inputPeak[])
+void MixerMeter::AttachMeter()
 {
-    uint64_t ts = os_gettime_ns();
-    QMutexLocker locker(&m_data_mutex);
+    if (!m_metered)
+        return;
+
+    auto meter = VolmeterHub::Get(m_source, m_type);
+    if (meter == m_meter)
+        return;
+
+    if (m_meter)
+        obs_volmeter_remove_callback(m_meter->Volmeter(), volume_meter, this);
+    auto old = std::move(m_meter);
+    m_meter = std::move(meter);
+    if (m_meter)
+        obs_volmeter_add_callback(m_meter->Volmeter(), volume_meter, this);
+    OnMeterChanged(old.get());
+}
 
-    m_current_last_update_time = ts;
+void MixerMeter::Update(const float magnitude[], const float peak[], const float inputPeak[])
+{
+    // Runs on the audio thread, must never wait for the graphics thread
+    auto& levels = m_levels.Back();
 
-    if (m_clipping) {
-        if ((ts - m_clip_begin_time) * 0.000001 > CLIP_FLASH_DURATION_MS) {
-            m_clipping = false;
+    // If the graphics thread didn't pick up the previous levels yet keep their
+    // peaks, so short peaks between two frames are not lost
+    for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++) {
+        levels.magnitude[channelNr] = magnitude[channelNr];
+        if (m_levels_unread) {
+            levels.peak[channelNr] = fmaxf(levels.peak[channelNr], peak[channelNr]);
+            levels.input_peak[channelNr] = fmaxf(levels.input_peak[channelNr], inputPeak[channelNr]);
+        } else {
+            levels.peak[channelNr] = peak[channelNr];
+            levels.input_peak[channelNr] = inputPeak[channelNr];
         }
     }
+    levels.ts = os_gettime_ns();
+    m_levels_unread = m_levels.Publish();
+}
 
-    for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++) {
-        m_current_magnitude[channelNr] = magnitude[channelNr];
-        m_current_peak[channelNr] = peak[channelNr];
-        m_current_input_peak[channelNr] = inputPeak[channelNr];
+void MixerMeter::ConsumeLevels(uint64_t ts)
+{
+    if (m_levels.Consume()) {
+        auto const& levels = m_levels.Front();
+        m_current_last_update_time = levels.ts;
+        for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++) {
+            m_ballistics.current_magnitude[channelNr] = levels.magnitude[channelNr];
+            m_ballistics.current_peak[channelNr] = levels.peak[channelNr];
+            m_ballistics.current_input_peak[channelNr] = levels.input_peak[channelNr];
+        }
     }
 
-    // In case there are more updates then redraws we must make sure
-    // that the ballistics of peak and hold are recalculated.
-    locker.unlock();
-    CalculateBallistics(ts);
+    if (m_clipping && ts > m_clip_begin_time && (ts - m_clip_begin_time) * 0.000001 > CLIP_FLASH_DURATION_MS)
+        m_clipping = false;
 }
 
 void MixerMeter::SetSource(OBSSource src)
@@ -157,98 +298,63 @@ void MixerMeter::SetSource(OBSSource src)
         },
         this);
 
-    if (m_meter) {
-
-        int currentNrAudioChannels = obs_volmeter_get_nr_channels(m_meter);
-
+    if (m_has_type) {
         m_muted = obs_source_muted(src);
-        if (!currentNrAudioChannels) {
-            struct obs_audio_info oai;
-            obs_get_audio_info(&oai);
-            currentNrAudioChannels = (oai.speakers == SPEAKERS_MONO) ? 1 : 2;
-        }
-        m_channels = currentNrAudioChannels;
-
-        obs_volmeter_detach_source(m_meter);
-        obs_volmeter_attach_source(m_meter, m_source);
+        AttachMeter();
+        UpdateChannelCount();
     }
 }
 
-inline void
-MixerMeter::CalculateBallisticsForChannel(int channelNr, uint64_t ts,
-    qreal timeSinceLastRedraw)
+void MixerMeter::UpdateChannelCount()
 {
-    if (m_current_peak[channelNr] >= m_display_peak[channelNr] || isnan(m_display_peak[channelNr])) {
-        // Attack of peak is immediate.
-        m_display_peak[channelNr] = m_current_peak[channelNr];
-    } else {
-        // Decay of peak is 40 dB / 1.7 seconds for Fast Profile
-        // 20 dB / 1.7 seconds for Medium Profile (Type I PPM)
-        // 24 dB / 2.8 seconds for Slow Profile (Type II PPM)
-        float decay = float(m_peak_decay_rate * timeSinceLastRedraw);
-        m_display_peak[channelNr] = CLAMP(m_display_peak[channelNr] - decay,
-            m_current_peak[channelNr], 0);
+    int currentNrAudioChannels = m_meter ? obs_volmeter_get_nr_channels(m_meter->Volmeter()) : 0;
+    if (!currentNrAudioChannels) {
+        struct obs_audio_info oai;
+        obs_get_audio_info(&oai);
+        currentNrAudioChannels = (oai.speakers == SPEAKERS_MONO) ? 1 : 2;
     }
+    m_channels = currentNrAudioChannels;
+}
 
-    if (m_current_peak[channelNr] >= m_display_peak_hold[channelNr] || !isfinite(m_display_peak_hold[channelNr])) {
-        // Attack of peak-hold is immediate, but keep track
-        // when it was last updated.
-        m_display_peak_hold[channelNr] = m_current_peak[channelNr];
-        m_display_peak_hold_last_update_time[channelNr] = ts;
-    } else {
-        // The peak and hold falls back to peak
-        // after 20 seconds.
-        qreal timeSinceLastPeak = (uint64_t)(ts - m_display_peak_hold_last_update_time[channelNr]) * 0.000000001;
-        if (timeSinceLastPeak > m_peak_hold_duration) {
-            m_display_peak_hold[channelNr] = m_current_peak[channelNr];
-            m_display_peak_hold_last_update_time[channelNr] = ts;
-        }
-    }
+void MixerMeter::SetMetered(bool metered)
+{
+    if (metered == m_metered)
+        return;
+    m_metered = metered;
 
-    if (m_current_input_peak[channelNr] >= m_display_input_peak_hold[channelNr] || !isfinite(m_display_input_peak_hold[channelNr])) {
-        // Attack of peak-hold is immediate, but keep track
-        // when it was last updated.
-        m_display_input_peak_hold[channelNr] = m_current_input_peak[channelNr];
-        m_display_input_peak_hold_last_upate_time[channelNr] = ts;
-    } else {
-        // The peak and hold falls back to peak after 1 second.
-        qreal timeSinceLastPeak = (uint64_t)(ts - m_display_input_peak_hold_last_upate_time[channelNr]) * 0.000000001;
-        if (timeSinceLastPeak > m_input_peak_hold_duration) {
-            m_display_input_peak_hold[channelNr] = m_current_input_peak[channelNr];
-            m_display_input_peak_hold_last_upate_time[channelNr] = ts;
+    if (metered) {
+        if (m_has_type) {
+            AttachMeter();
+            UpdateChannelCount();
         }
-    }
-
-    if (!isfinite(m_display_magnitude[channelNr])) {
-        // The statements in the else-leg do not work with
-        // NaN and infinite displayMagnitude.
-        m_display_magnitude[channelNr] = m_current_magnitude[channelNr];
-    } else {
-        // A VU meter will integrate to the new value to 99% in 300 ms.
-        // The calculation here is very simplified and is more accurate
-        // with higher frame-rate.
-        float attack = float((m_current_magnitude[channelNr] - m_display_magnitude[channelNr]) * (timeSinceLastRedraw / m_magnitude_integration_time) * 0.99);
-        m_display_magnitude[channelNr] = CLAMP(m_display_magnitude[channelNr] + attack,
-            (float)m_minimum_level, 0);
+    } else if (m_meter) {
+        obs_volmeter_remove_callback(m_meter->Volmeter(), volume_meter, this);
+        auto old = std::move(m_meter);
+        ResetLevels();
+        OnMeterChanged(old.get());
     }
 }
 
 void MixerMeter::Render(float cell_scale, float, float src_scale_y)
 {
-    uint64_t ts = os_gettime_ns();
-    qreal timeSinceLastRedraw = (ts - m_last_redraw_time) * 0.000000001;
-    CalculateBallistics(ts, timeSinceLastRedraw);
-    bool idle = DetectIdle(ts);
-
     const auto bottom_indicator_size = m_channel_width / cell_scale;
     auto h = (m_height - bottom_indicator_size * 2) * src_scale_y; // do not include indicator and mute button in height
-    for (int i = 0; i < m_channels; i++) {
-        auto magnitude = m_display_magnitude[i];
-        auto peak = m_display_peak[i];
-        auto peak_hold = m_display_peak_hold[i];
+    // A single bar shows the loudest channel
+    auto level = [this](float const* values, int channel) {
+        if (!m_single_bar)
+            return values[channel];
+        float result = values[0];
+        for (int i = 1; i < m_channels; i++)
+            result = fmaxf(result, values[i]);
+        return result;
+    };
+
+    for (int i = 0; i < DisplayedChannels(); i++) {
+        auto magnitude = level(m_ballistics.magnitude, i);
+        auto peak = level(m_ballistics.peak, i);
+        auto peak_hold = level(m_ballistics.peak_hold, i);
         qreal scale = h / m_minimum_level;
 
-        QMutexLocker locker(&m_data_mutex);
         int lower_limit = m_y + h;
         int upper_limit = m_y;
         //        int magnitude_position = int(lower_limit - (magnitude * scale));
@@ -262,14 +368,21 @@ void MixerMeter::Render(float cell_scale, float, float src_scale_y)
         int error_length = warning_position - upper_limit;
         int error_position = 0;
 
-        locker.unlock();
         auto w = m_channel_width / cell_scale;
         auto x = m_x + (w + 2) * i;
 
         if (m_clipping)
             peak_position = 0;
 
-        if (peak_position > lower_limit) { // Peak is below the meter -> no peak visible
+        if (!(peak_position > error_position && peak_position > upper_limit) && !m_clipping) {
+            m_clip_begin_time = os_gettime_ns();
+            m_clipping = true;
+        }
+
+        auto size = 3 / cell_scale;
+        if (volume_effect.effect) {
+            draw_channel(x, upper_limit, w, h, peak, peak_hold, magnitude, size);
+        } else if (peak_position > lower_limit) { // Peak is below the meter -> no peak visible
             draw_rectangle(x, nominal_position, w, nominal_ength,
                 m_muted ? m_background_nominal_color_disabled
                         : m_background_nominal_color);
@@ -330,10 +443,6 @@ void MixerMeter::Render(float cell_scale, float, float src_scale_y)
                 m_muted ? m_foreground_warning_color_disabled
                         : m_foreground_warning_color);
         } else {
-            if (!m_clipping) {
-                m_clip_begin_time = os_gettime_ns();
-                m_clipping = true;
-            }
             int end = error_length + warning_length + nominal_ength;
 
             draw_rectangle(x, upper_limit, w, end,
@@ -341,8 +450,7 @@ void MixerMeter::Render(float cell_scale, float, float src_scale_y)
                         : m_foreground_error_color);
         }
 
-        auto size = 3 / cell_scale;
-        if (peak_hold_position - size > lower_limit)
+        if (volume_effect.effect || peak_hold_position - size > lower_limit)
             ;
         else if (peak_hold_position - size / 2 > nominal_position)
             draw_rectangle(x, peak_hold_position, w, size,
@@ -357,15 +465,15 @@ void MixerMeter::Render(float cell_scale, float, float src_scale_y)
                 m_muted ? m_foreground_error_color_disabled
                         : m_foreground_error_color);
 
-        if (magnitude_position - size / 2 >= upper_limit) {
+        if (!volume_effect.effect && magnitude_position - size / 2 >= upper_limit) {
             draw_rectangle(x, magnitude_position - size / 2, w, size,
                 m_magnitude_color);
         }
 
-        if (idle)
+        if (m_idle)
             continue;
 
-        auto input_peak_hold = m_display_input_peak_hold[i];
+        auto input_peak_hold = level(m_ballistics.input_peak_hold, i);
         uint32_t color;
         if (input_peak_hold < m_minimum_input_level)
             color = m_background_nominal_color;
@@ -380,15 +488,4 @@ void MixerMeter::Render(float cell_scale, float, float src_scale_y)
 
         draw_rectangle(x, lower_limit + 1 / cell_scale, w, w, color);
     }
-    m_last_redraw_time = ts;
-}
-
-inline void MixerMeter::CalculateBallistics(uint64_t ts,
-    qreal timeSinceLastRedraw)
-{
-    QMutexLocker locker(&m_data_mutex);
-
-    for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++)
-        CalculateBallisticsForChannel(channelNr, ts,
-            timeSinceLastRedraw);
 }
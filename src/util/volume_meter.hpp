@@ -16,47 +16,52 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *************************************************************************/
 #pragma once
+#include "meter_ballistics.hpp"
+#include "triple_buffer.hpp"
+#include "volmeter_hub.hpp"
 #include <QColor>
-#include <QMutex>
 #include <QtGlobal>
 #include <cstdint>
+#include <mutex>
+#include <vector>
 #include <obs-module.h>
 #include <obs.hpp>
 
 class MixerMeter {
 protected:
+    // Levels as reported by the volmeter, handed from the audio thread to the
+    // graphics thread without locking
+    struct Levels {
+        float magnitude[MAX_AUDIO_CHANNELS];
+        float peak[MAX_AUDIO_CHANNELS];
+        float input_peak[MAX_AUDIO_CHANNELS];
+        uint64_t ts;
+    };
+    TripleBuffer<Levels> m_levels;
+    bool m_levels_unread = false; // Audio thread only, last Publish() replaced unread levels
+
     bool m_muted = false;
     uint64_t m_clip_begin_time = 0;
-    uint64_t m_last_redraw_time = 0;
+    bool m_idle = true;
     uint64_t m_current_last_update_time = 0;
     int m_channels = 0;
     bool m_clipping = false;
     OBSSource m_source;
-    obs_volmeter_t* m_meter {};
+    std::shared_ptr<VolmeterHub::Entry> m_meter;
+    obs_fader_type m_type {};
+    bool m_has_type = false;
+    bool m_metered = true;     // False while nothing needs this meter's levels
+    bool m_single_bar = false; // Show one bar with the loudest channel
 
     int m_x, m_y, m_height, m_channel_width;
 
-    float m_current_magnitude[MAX_AUDIO_CHANNELS];
-    float m_current_peak[MAX_AUDIO_CHANNELS];
-    float m_current_input_peak[MAX_AUDIO_CHANNELS];
-
-    float m_display_magnitude[MAX_AUDIO_CHANNELS];
-    float m_display_peak[MAX_AUDIO_CHANNELS];
-    float m_display_peak_hold[MAX_AUDIO_CHANNELS];
-    uint64_t m_display_peak_hold_last_update_time[MAX_AUDIO_CHANNELS];
-    float m_display_input_peak_hold[MAX_AUDIO_CHANNELS];
-    uint64_t m_display_input_peak_hold_last_upate_time[MAX_AUDIO_CHANNELS];
+    MeterBallistics<> m_ballistics;
 
     qreal m_minimum_level;
     qreal m_warning_level;
     qreal m_error_level;
     qreal m_clip_level;
     qreal m_minimum_input_level;
-    qreal m_peak_decay_rate;
-    qreal m_magnitude_integration_time;
-    qreal m_peak_hold_duration;
-    qreal m_input_peak_hold_duration;
-    QMutex m_data_mutex;
 
     uint32_t m_background_nominal_color;
     uint32_t m_background_warning_color;
@@ -78,6 +83,8 @@ protected:
     uint32_t m_minor_tick_color;
 
     void draw_rectangle(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color);
+    void draw_channel(float x, float y, float w, float h, float peak, float peak_hold, float magnitude, float marker_size);
+    float level_position(float db) const;
 
     OBSSignal vol_changed_signal;
     OBSSignal mixersSignal;
@@ -87,13 +94,34 @@ protected:
 
     virtual void OnSourceNameChanged() { }
     virtual void OnSourceVolumeChanged() { }
+    /// Called after m_meter was swapped, old is kept alive until this returns
+    virtual void OnMeterChanged(VolmeterHub::Entry* /*old*/) { }
+
+    void AttachMeter();
+    void UpdateChannelCount();
+
+    void ConsumeLevels(uint64_t ts);
+
+    // All live meters, advanced together by Tick() on the graphics thread
+    static std::mutex s_meters_mutex;
+    static std::vector<MixerMeter*> s_meters;
+    static void Tick(void*, float seconds);
 
 public:
+    /// Loads/frees volume.effect, which draws a whole channel with one quad
+    /// and starts/stops the ballistics tick
+    static void Init();
+    static void Deinit();
+
     MixerMeter(OBSSource, int x = 10, int y = 10, int height = 100, int channel_width = 3);
     ~MixerMeter();
 
     bool DetectIdle(uint64_t ts)
     {
+        // Levels published by the audio thread after ts was read are newer
+        // than ts, the meter is certainly not idle then
+        if (ts <= m_current_last_update_time)
+            return false;
         double timeSinceLastUpdate = (ts - m_current_last_update_time) * 0.000000001;
         if (timeSinceLastUpdate > 0.5) {
             ResetLevels();
@@ -107,6 +135,10 @@ public:
 
     void SetMuted(bool m) { m_muted = m; }
 
+    /// Subscribes to/unsubscribes from the shared volmeter of the source
+    void SetMetered(bool metered);
+    void SetSingleBar(bool b) { m_single_bar = b; }
+
     void Update(const float magnitude[MAX_AUDIO_CHANNELS],
         const float peak[MAX_AUDIO_CHANNELS],
         const float inputPeak[MAX_AUDIO_CHANNELS]);
@@ -114,24 +146,14 @@ public:
     void ResetLevels()
     {
         m_current_last_update_time = 0;
-        for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++) {
-            m_current_magnitude[channelNr] = -M_INFINITE;
-            m_current_peak[channelNr] = -M_INFINITE;
-            m_current_input_peak[channelNr] = -M_INFINITE;
-
-            m_display_magnitude[channelNr] = -M_INFINITE;
-            m_display_peak[channelNr] = -M_INFINITE;
-            m_display_peak_hold[channelNr] = -M_INFINITE;
-            m_display_peak_hold_last_update_time[channelNr] = 0;
-            m_display_input_peak_hold[channelNr] = -M_INFINITE;
-            m_display_input_peak_hold_last_upate_time[channelNr] = 0;
-        }
+        m_ballistics.Reset();
     }
 
     int GetX() const { return m_x; }
     int GetY() const { return m_y; }
     int GetHeight() const { return m_height; }
-    int GetWidth() const { return (m_channel_width + 2) * m_channels; }
+    int DisplayedChannels() const { return m_single_bar ? qMin(m_channels, 1) : m_channels; }
+    int GetWidth() const { return (m_channel_width + 2) * DisplayedChannels(); }
     void SetPos(int x, int y)
     {
         m_x = x;
@@ -144,15 +166,10 @@ public:
     }
 
     virtual void SetSource(OBSSource);
+    obs_source_t* GetSource() const { return m_source; }
 
     virtual void Render(float cell_scale, float source_scale_x, float source_scale_y);
 
-    void CalculateBallistics(uint64_t ts,
-        qreal timeSinceLastRedraw = 0.0);
-
-    void CalculateBallisticsForChannel(int channelNr, uint64_t ts,
-        qreal timeSinceLastRedraw = 0.0);
-
     void SetChannelWidth(int w)
     {
         m_channel_width = w;
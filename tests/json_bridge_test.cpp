@@ -0,0 +1,159 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+/* Checks that JsonBridge converts between jansson and Qt without losing
+ * numbers, nesting or strings that a text round trip would mangle.
+ */
+
+#include "util/json_bridge.hpp"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+
+static int Failures = 0;
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            printf("%s:%i: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            Failures++;                                                \
+        }                                                              \
+    } while (0)
+
+// Converts to Qt and back, compares with the original and takes the reference
+static bool RoundTrips(json_t* json)
+{
+    auto* back = JsonBridge::ToJansson(JsonBridge::ToQt(json));
+    bool const equal = json_equal(json, back);
+    json_decref(back);
+    json_decref(json);
+    return equal;
+}
+
+static void TestIntegers()
+{
+    for (json_int_t v : { json_int_t(0), json_int_t(-1), json_int_t(INT32_MAX), json_int_t(INT32_MIN),
+             json_int_t(1) << 53, (json_int_t(1) << 53) + 1, json_int_t(INT64_MAX), json_int_t(INT64_MIN) }) {
+        auto* json = json_integer(v);
+        auto const qt = JsonBridge::ToQt(json);
+        CHECK(qt.isDouble());
+        CHECK(qt.toInteger() == v);
+
+        auto* back = JsonBridge::ToJansson(qt);
+        CHECK(json_is_integer(back));
+        CHECK(json_integer_value(back) == v);
+        json_decref(back);
+        json_decref(json);
+    }
+
+    // Integers coming from Qt stay integers
+    auto* back = JsonBridge::ToJansson(QJsonValue(qint64(INT64_MIN)));
+    CHECK(json_is_integer(back) && json_integer_value(back) == INT64_MIN);
+    json_decref(back);
+}
+
+static void TestReals()
+{
+    for (double v : { 0.5, -0.1, 1e-300, 5e-324, 1e308, -DBL_MAX, 1500000000000000.25 }) {
+        auto* json = json_real(v);
+        auto const qt = JsonBridge::ToQt(json);
+        CHECK(qt.toDouble() == v);
+
+        auto* back = JsonBridge::ToJansson(qt);
+        CHECK(json_is_real(back));
+        CHECK(json_real_value(back) == v);
+        json_decref(back);
+        json_decref(json);
+    }
+
+    // Whole reals may come back as integers, but never with another value
+    auto* whole = json_real(2.0);
+    auto* back = JsonBridge::ToJansson(JsonBridge::ToQt(whole));
+    CHECK(json_is_number(back) && json_number_value(back) == 2.0);
+    json_decref(back);
+    json_decref(whole);
+}
+
+static void TestNesting()
+{
+    CHECK(RoundTrips(json_pack("{s:[i,[i,{s:n}]],s:{s:b,s:b},s:[],s:{}}",
+        "a", 1, 2, "b", "c", "d", 1, "e", 0, "empty_array", "empty_object")));
+    CHECK(RoundTrips(json_pack("[[[[[s]]]],{s:{s:{s:f}}}]", "deep", "a", "b", "c", 0.25)));
+
+    auto* json = json_pack("{s:[i,s,n,b]}", "list", 7, "seven", 0);
+    auto const qt = JsonBridge::ToQt(json).toObject();
+    auto const list = qt["list"].toArray();
+    CHECK(list.size() == 4);
+    CHECK(list[0].toInteger() == 7);
+    CHECK(list[1].toString() == "seven");
+    CHECK(list[2].isNull());
+    CHECK(list[3].isBool() && !list[3].toBool());
+    json_decref(json);
+}
+
+static void TestStrings()
+{
+    // Embedded null characters in keys and values
+    auto* json = json_object();
+    json_object_setn_new(json, "a\0b", 3, json_stringn("x\0y", 3));
+    auto const qt = JsonBridge::ToQt(json).toObject();
+    auto const key = QString::fromUtf8("a\0b", 3);
+    CHECK(qt.size() == 1);
+    CHECK(qt.contains(key));
+    CHECK(qt[key].toString() == QString::fromUtf8("x\0y", 3));
+    CHECK(RoundTrips(json));
+
+    // Characters outside the basic multilingual plane are surrogate pairs in Qt
+    char const* emoji = "\xF0\x9F\x98\x80"; // U+1F600
+    json = json_pack("{s:s}", emoji, emoji);
+    auto const str = JsonBridge::ToQt(json).toObject()[QString::fromUtf8(emoji)].toString();
+    CHECK(str.size() == 2);
+    CHECK(str.toUcs4().value(0) == 0x1F600);
+    CHECK(RoundTrips(json));
+
+    CHECK(RoundTrips(json_string("")));
+    CHECK(RoundTrips(json_string("\xC3\xA4\xE2\x82\xAC")));
+}
+
+static void TestSpecialValues()
+{
+    CHECK(JsonBridge::ToQt(nullptr).isUndefined());
+    for (auto const& v : { QJsonValue(QJsonValue::Null), QJsonValue(QJsonValue::Undefined) }) {
+        auto* json = JsonBridge::ToJansson(v);
+        CHECK(json_is_null(json));
+        json_decref(json);
+    }
+    CHECK(RoundTrips(json_true()));
+    CHECK(RoundTrips(json_false()));
+    CHECK(RoundTrips(json_null()));
+}
+
+int main()
+{
+    TestIntegers();
+    TestReals();
+    TestNesting();
+    TestStrings();
+    TestSpecialValues();
+
+    if (Failures)
+        printf("%i check(s) failed\n", Failures);
+    return Failures ? 1 : 0;
+}
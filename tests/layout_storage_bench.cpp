@@ -0,0 +1,119 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+/* Load/save times of the JSON and CBOR layout files for a large synthetic
+ * scene collection. Usage:
+ *   layout_storage_bench [iterations]
+ * Exits with 1 if a format doesn't give back the layouts it was given.
+ */
+
+#include <QCborValue>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// Same as EncodeLayouts()/DecodeLayouts() in config.cpp
+QByteArray Encode(QJsonArray const& layouts, bool binary)
+{
+    if (binary)
+        return QCborValue::fromJsonValue(layouts).toCbor();
+    return QJsonDocument(layouts).toJson();
+}
+
+QJsonArray Decode(QByteArray const& data, bool binary)
+{
+    if (binary)
+        return QCborValue::fromCbor(data).toJsonValue().toArray();
+    return QJsonDocument::fromJson(data).array();
+}
+
+// Items with the keys a source item writes
+QJsonArray MakeLayouts(int layouts, int items)
+{
+    QJsonArray result;
+    for (int l = 0; l < layouts; l++) {
+        QJsonArray list;
+        for (int i = 0; i < items; i++) {
+            QJsonObject item;
+            item["id"] = "source_item";
+            item["col"] = i % 16;
+            item["row"] = i / 16;
+            item["width"] = 1;
+            item["height"] = 1;
+            item["source"] = QString("Camera %1").arg(i);
+            item["source_uuid"] = QString("6f0c5c4e-2f9d-4a7b-9d2e-%1").arg(i, 12, 10, QChar('0'));
+            item["show_safe_borders"] = i % 3 == 0;
+            item["show_label"] = true;
+            item["show_volume"] = i % 2 == 0;
+            item["detect_static"] = false;
+            item["font_scale"] = 1.25;
+            item["max_fps"] = 0;
+            item["volume_meter_channel_width"] = 3;
+            item["volume_meter_height"] = 0.5;
+            item["volume_meter_x"] = 10;
+            item["volume_meter_y"] = 10;
+            list.append(item);
+        }
+
+        QJsonObject layout;
+        layout["cols"] = 16;
+        layout["rows"] = items / 16 + 1;
+        layout["locked"] = false;
+        layout["render_budget_ms"] = 0;
+        layout["gpu_timing"] = false;
+        layout["items"] = list;
+        result.append(layout);
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int const iterations = argc > 1 ? atoi(argv[1]) : 50;
+    auto const layouts = MakeLayouts(4, 256);
+    bool ok = true;
+
+    for (bool binary : { false, true }) {
+        QByteArray data;
+        QJsonArray decoded;
+        QElapsedTimer timer;
+
+        timer.start();
+        for (int i = 0; i < iterations; i++)
+            data = Encode(layouts, binary);
+        double const save_us = timer.nsecsElapsed() / 1000.0 / iterations;
+
+        timer.restart();
+        for (int i = 0; i < iterations; i++)
+            decoded = Decode(data, binary);
+        double const load_us = timer.nsecsElapsed() / 1000.0 / iterations;
+
+        bool const same = decoded == layouts;
+        ok &= same;
+        printf("%s: %8lli bytes, save %10.1f us, load %10.1f us%s\n", binary ? "cbor" : "json",
+            qint64(data.size()), save_us, load_us, same ? "" : ", round trip differs");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/*************************************************************************
+ * This file is part of durchblick
+ * git.vrsal.xyz/alex/durchblick
+ * Copyright 2023 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+/* Compares MeterBallistics against the scalar per-channel code it replaced.
+ * The scalar code took its timestamps from os_gettime_ns(), here the clock is
+ * a template parameter so both kernels see the same frame times. Usage:
+ *   meter_ballistics_bench [frames]
+ * Exits with 1 if the two kernels disagree.
+ */
+
+#include "util/meter_ballistics.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Advances by a fixed step every frame, 1/64 s is exact in float and in ns
+struct FakeClock {
+    static constexpr uint64_t step_ns = 15625000;
+    uint64_t now_ns = 0;
+
+    uint64_t Now() const { return now_ns; }
+    void Advance() { now_ns += step_ns; }
+};
+
+// The former MixerMeter::CalculateBallisticsForChannel, unchanged apart from
+// the clock and the CLAMP() macro spelled out
+template<class Clock>
+struct ScalarBallistics {
+    Clock const& clock;
+    // Same profile as the default policies, the old code rounded it to 11.76
+    double peak_decay_rate = Ballistics::PpmMedium::peak_decay_rate;
+    double magnitude_integration_time = Ballistics::Vu::integration_time;
+    double peak_hold_duration = Ballistics::PeakHold::peak_hold_duration;
+    double input_peak_hold_duration = Ballistics::PeakHold::input_peak_hold_duration;
+    double minimum_level = -60.0;
+
+    float current_magnitude[MAX_AUDIO_CHANNELS];
+    float current_peak[MAX_AUDIO_CHANNELS];
+    float current_input_peak[MAX_AUDIO_CHANNELS];
+    float display_magnitude[MAX_AUDIO_CHANNELS];
+    float display_peak[MAX_AUDIO_CHANNELS];
+    float display_peak_hold[MAX_AUDIO_CHANNELS];
+    uint64_t display_peak_hold_last_update_time[MAX_AUDIO_CHANNELS];
+    float display_input_peak_hold[MAX_AUDIO_CHANNELS];
+    uint64_t display_input_peak_hold_last_update_time[MAX_AUDIO_CHANNELS];
+
+    explicit ScalarBallistics(Clock const& c)
+        : clock(c)
+    {
+        for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+            current_magnitude[i] = current_peak[i] = current_input_peak[i] = -M_INFINITE;
+            display_magnitude[i] = display_peak[i] = display_peak_hold[i] = display_input_peak_hold[i] = -M_INFINITE;
+            display_peak_hold_last_update_time[i] = display_input_peak_hold_last_update_time[i] = 0;
+        }
+    }
+
+    static float Clamp(float x, float min, float max)
+    {
+        return x < min ? min : (x > max ? max : x);
+    }
+
+    void StepChannel(int channelNr, uint64_t ts, double timeSinceLastRedraw)
+    {
+        if (current_peak[channelNr] >= display_peak[channelNr] || std::isnan(display_peak[channelNr])) {
+            display_peak[channelNr] = current_peak[channelNr];
+        } else {
+            float decay = float(peak_decay_rate * timeSinceLastRedraw);
+            display_peak[channelNr] = Clamp(display_peak[channelNr] - decay, current_peak[channelNr], 0);
+        }
+
+        if (current_peak[channelNr] >= display_peak_hold[channelNr] || !std::isfinite(display_peak_hold[channelNr])) {
+            display_peak_hold[channelNr] = current_peak[channelNr];
+            display_peak_hold_last_update_time[channelNr] = ts;
+        } else {
+            double timeSinceLastPeak = (uint64_t)(ts - display_peak_hold_last_update_time[channelNr]) * 0.000000001;
+            if (timeSinceLastPeak > peak_hold_duration) {
+                display_peak_hold[channelNr] = current_peak[channelNr];
+                display_peak_hold_last_update_time[channelNr] = ts;
+            }
+        }
+
+        if (current_input_peak[channelNr] >= display_input_peak_hold[channelNr] || !std::isfinite(display_input_peak_hold[channelNr])) {
+            display_input_peak_hold[channelNr] = current_input_peak[channelNr];
+            display_input_peak_hold_last_update_time[channelNr] = ts;
+        } else {
+            double timeSinceLastPeak = (uint64_t)(ts - display_input_peak_hold_last_update_time[channelNr]) * 0.000000001;
+            if (timeSinceLastPeak > input_peak_hold_duration) {
+                display_input_peak_hold[channelNr] = current_input_peak[channelNr];
+                display_input_peak_hold_last_update_time[channelNr] = ts;
+            }
+        }
+
+        if (!std::isfinite(display_magnitude[channelNr])) {
+            display_magnitude[channelNr] = current_magnitude[channelNr];
+        } else {
+            float attack = float((current_magnitude[channelNr] - display_magnitude[channelNr]) * (timeSinceLastRedraw / magnitude_integration_time) * 0.99);
+            display_magnitude[channelNr] = Clamp(display_magnitude[channelNr] + attack, (float)minimum_level, 0);
+        }
+    }
+
+    void Step(double seconds)
+    {
+        uint64_t ts = clock.Now();
+        for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++)
+            StepChannel(channelNr, ts, seconds);
+    }
+};
+
+// Levels between -70 and +3 dB with some silence (-inf) and the odd NaN
+struct LevelGenerator {
+    uint32_t state = 0x12345678;
+
+    float Next()
+    {
+        state = state * 1664525u + 1013904223u;
+        uint32_t r = state >> 8;
+        if (r % 251 == 0)
+            return std::numeric_limits<float>::quiet_NaN();
+        if (r % 13 == 0)
+            return -std::numeric_limits<float>::infinity();
+        return -70.f + float(r % 7300) * 0.01f;
+    }
+};
+
+bool Same(float a, float b)
+{
+    if (std::isnan(a) || std::isnan(b))
+        return std::isnan(a) && std::isnan(b);
+    if (!std::isfinite(a) || !std::isfinite(b))
+        return a == b;
+    // The scalar code computed decay and attack in double
+    return std::fabs(a - b) <= 1e-3f;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int const frames = argc > 1 ? atoi(argv[1]) : 100000;
+    int const meters = 64;
+    float const dt = FakeClock::step_ns * 1e-9f;
+
+    FakeClock clock;
+    std::vector<ScalarBallistics<FakeClock>> scalar(meters, ScalarBallistics<FakeClock>(clock));
+    std::vector<MeterBallistics<>> soa(meters);
+    for (auto& b : soa)
+        b.Reset();
+
+    LevelGenerator gen;
+    using steady = std::chrono::steady_clock;
+    steady::duration scalar_time {}, soa_time {};
+    size_t mismatches = 0;
+
+    for (int f = 0; f < frames; f++) {
+        clock.Advance();
+        for (int m = 0; m < meters; m++) {
+            for (int c = 0; c < MAX_AUDIO_CHANNELS; c++) {
+                float const mag = gen.Next(), peak = gen.Next(), input = gen.Next();
+                scalar[m].current_magnitude[c] = soa[m].current_magnitude[c] = mag;
+                scalar[m].current_peak[c] = soa[m].current_peak[c] = peak;
+                scalar[m].current_input_peak[c] = soa[m].current_input_peak[c] = input;
+            }
+        }
+
+        auto t0 = steady::now();
+        for (auto& b : scalar)
+            b.Step(dt);
+        auto t1 = steady::now();
+        for (auto& b : soa)
+            b.Step(dt, -60.f);
+        auto t2 = steady::now();
+        scalar_time += t1 - t0;
+        soa_time += t2 - t1;
+
+        for (int m = 0; m < meters; m++) {
+            auto const& s = scalar[m];
+            auto const& v = soa[m];
+            for (int c = 0; c < MAX_AUDIO_CHANNELS; c++) {
+                if (!Same(s.display_magnitude[c], v.magnitude[c]) || !Same(s.display_peak[c], v.peak[c])
+                    || !Same(s.display_peak_hold[c], v.peak_hold[c]) || !Same(s.display_input_peak_hold[c], v.input_peak_hold[c])) {
+                    if (mismatches++ < 10)
+                        printf("Mismatch in frame %i, meter %i, channel %i\n", f, m, c);
+                }
+            }
+        }
+    }
+
+    auto ns = [](steady::duration d) { return double(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()); };
+    double const steps = double(frames) * meters;
+    printf("%i frames, %i meters, %i channels\n", frames, meters, MAX_AUDIO_CHANNELS);
+    printf("scalar: %8.2f ns per meter step\n", ns(scalar_time) / steps);
+    printf("soa:    %8.2f ns per meter step\n", ns(soa_time) / steps);
+    printf("%zu mismatches\n", mismatches);
+    return mismatches ? 1 : 0;
+}